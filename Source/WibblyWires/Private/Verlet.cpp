@@ -0,0 +1,535 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "Verlet.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/MemStack.h"
+
+float WireShrinkRate = 150.f;
+FAutoConsoleVariableRef CVarWireShrinkRate(
+	TEXT("WibblyWires.WireShrinkRate"),
+	WireShrinkRate,
+	TEXT("How quickly should wires get sucked back into their nodes after having been cut")
+);
+
+float SecondsBeforeBreaking = 1.f;
+FAutoConsoleVariableRef CVarSecondsBeforeBreaking(
+	TEXT("WibblyWires.SecondsBeforeBreaking"),
+	SecondsBeforeBreaking,
+	TEXT("How many seconds should cut wires dangle before detaching from their nodes and falling")
+);
+
+float WireFriction = 0.9996f;
+FAutoConsoleVariableRef CVarWireFriction(
+	TEXT("WibblyWires.WireFriction"),
+	WireFriction,
+	TEXT("Friction multiplier for velocities, should be very close to 1.")
+);
+
+int32 ChainSolver = (int32)EVerletStickSolver::Relax;
+FAutoConsoleVariableRef CVarChainSolver(
+	TEXT("WibblyWires.ChainSolver"),
+	ChainSolver,
+	TEXT("How chains hold their stick lengths each substep.\n")
+	TEXT("0: Relax them a few times over (PBD)\n")
+	TEXT("1: Solve them exactly with one tridiagonal solve. Only applies to chains that are a single run of sticks, which is all of them unless they're built by hand\n")
+	TEXT("2: XPBD, where stiffness comes from each stick's compliance rather than how many passes there are. Takes a single pass each substep, over twice the substeps")
+);
+
+int32 ChainTethers = 1;
+FAutoConsoleVariableRef CVarChainTethers(
+	TEXT("WibblyWires.ChainTethers"),
+	ChainTethers,
+	TEXT("Whether points on pinned chains are also tethered to their nearest pin, so they can't hang further from it than the chain between them.\n")
+	TEXT("Tethers hold the pins in a single pass, so tethered chains get away with fewer relaxation passes.")
+);
+
+float StickCompliance = 0.f;
+FAutoConsoleVariableRef CVarStickCompliance(
+	TEXT("WibblyWires.StickCompliance"),
+	StickCompliance,
+	TEXT("Compliance (inverse stiffness) given to new chain sticks, only used by the XPBD chain solver. 0 is perfectly rigid.")
+);
+
+namespace VerletSolver
+{
+	// Whether stick i joins point i to point i + 1 for every stick, as AddToChain builds them
+	static bool IsSingleRun(const TArray<FVerletStick>& Sticks, int32 NumPoints)
+	{
+		if (Sticks.Num() != NumPoints - 1)
+		{
+			return false;
+		}
+
+		for (int32 i = 0; i < Sticks.Num(); i++)
+		{
+			if (Sticks[i].Point0Index != i || Sticks[i].Point1Index != i + 1)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// A stick as the relax pass wants it, with each end's share of the correction worked out up front
+	struct FPackedStick
+	{
+		int32 Point0Index;
+		int32 Point1Index;
+		float DesiredLength;
+		float Share0;
+		float Share1;
+	};
+
+	// Everything about how a chain should be solved that's only known at runtime
+	struct FSolveSettings
+	{
+		float Friction;
+		EVerletStickSolver StickSolver;
+		bool bTethers;
+	};
+
+	/**
+	 * The chain solver, with everything that's fixed for a given chain baked in at compile time. For the common
+	 * configurations the substep and iteration loops have constant trip counts and the pinned checks fold away to
+	 * nothing (or an index compare), leaving straight-line inner loops. CompileTimeSubsteps of 0 takes the count at runtime.
+	 */
+	template <int32 CompileTimeSubsteps, int32 Iterations, EVerletPinning Pinning>
+	struct TChainSolver
+	{
+		static FORCEINLINE bool IsPinned(const FVerletPoint* Points, int32 Index, int32 LastIndex)
+		{
+			if (Pinning == EVerletPinning::None)
+			{
+				return false;
+			}
+			else if (Pinning == EVerletPinning::Ends)
+			{
+				return Index == 0 || Index == LastIndex;
+			}
+			return Points[Index].bIsPinned;
+		}
+
+		// Only the points that can move. With just the ends pinned that's everything in between, otherwise it's the active list.
+		template <typename FunctionType>
+		static FORCEINLINE void ForEachFreePoint(const FVerletChain& Chain, FunctionType&& Function)
+		{
+			if (Pinning == EVerletPinning::Arbitrary)
+			{
+				for (int32 Index : Chain.ActivePoints)
+				{
+					Function(Index);
+				}
+				return;
+			}
+
+			const int32 First = Pinning == EVerletPinning::Ends ? 1 : 0;
+			const int32 End = Pinning == EVerletPinning::Ends ? Chain.Points.Num() - 1 : Chain.Points.Num();
+			for (int32 Index = First; Index < End; Index++)
+			{
+				Function(Index);
+			}
+		}
+
+		// Only the sticks with an end that can move
+		template <typename FunctionType>
+		static FORCEINLINE void ForEachActiveStick(const FVerletChain& Chain, FunctionType&& Function)
+		{
+			if (Pinning == EVerletPinning::None)
+			{
+				for (int32 Index = 0; Index < Chain.Sticks.Num(); Index++)
+				{
+					Function(Index);
+				}
+				return;
+			}
+
+			for (int32 Index : Chain.ActiveSticks)
+			{
+				Function(Index);
+			}
+		}
+
+		/**
+		 * Solves every stick of a single run at once. The length constraints are linearised about the current positions,
+		 * which makes J W J^T tridiagonal (each stick only shares a point with its neighbours), so one Thomas algorithm pass
+		 * finds the corrections that satisfy them all together. Gauss-Seidel only passes each correction one stick along per
+		 * sweep, so long chains stretch, where this is exact to first order whatever the length.
+		 */
+		static void SolveSticksDirect(FVerletPoint* RESTRICT Points, const FVerletStick* RESTRICT Sticks, int32 NumSticks, int32 LastIndex)
+		{
+			if (NumSticks == 0)
+			{
+				return;
+			}
+
+			FMemMark Mark(FMemStack::Get());
+			TArray<FVectorType, TMemStackAllocator<>> Normals;
+			TArray<float, TMemStackAllocator<>> Upper;
+			TArray<float, TMemStackAllocator<>> Lambdas;
+			Normals.SetNumUninitialized(NumSticks);
+			Upper.SetNumUninitialized(NumSticks);
+			Lambdas.SetNumUninitialized(NumSticks);
+
+			for (int32 i = 0; i < NumSticks; i++)
+			{
+				const FVectorType Delta = Points[i + 1].Position - Points[i].Position;
+				const float Length = Delta.Size();
+				Normals[i] = Length > SMALL_NUMBER ? Delta / Length : FVectorType::ZeroVector;
+				// Right hand side to start with, it's overwritten as it's eliminated
+				Lambdas[i] = Sticks[i].DesiredLength - Length;
+			}
+
+			// Forward elimination. Row i couples to row i - 1 by -W(i) (N(i-1).N(i)) and to row i + 1 by -W(i+1) (N(i).N(i+1)).
+			float PreviousUpper = 0.f;
+			for (int32 i = 0; i < NumSticks; i++)
+			{
+				const float Weight0 = IsPinned(Points, i, LastIndex) ? 0.f : 1.f;
+				const float Weight1 = IsPinned(Points, i + 1, LastIndex) ? 0.f : 1.f;
+				const float Lower = i > 0 ? -Weight0 * (Normals[i - 1] | Normals[i]) : 0.f;
+				const float Diagonal = Weight0 + Weight1;
+				const float UpperCoupling = i < NumSticks - 1 ? -Weight1 * (Normals[i] | Normals[i + 1]) : 0.f;
+
+				// Sticks with both ends pinned can't do anything, and neither of their neighbours couple to them either
+				if (Diagonal == 0.f)
+				{
+					Upper[i] = 0.f;
+					Lambdas[i] = 0.f;
+					PreviousUpper = 0.f;
+					continue;
+				}
+
+				float Pivot = Diagonal - Lower * PreviousUpper;
+				Pivot = FMath::Abs(Pivot) > SMALL_NUMBER ? Pivot : SMALL_NUMBER;
+				Upper[i] = UpperCoupling / Pivot;
+				Lambdas[i] = (Lambdas[i] - (i > 0 ? Lower * Lambdas[i - 1] : 0.f)) / Pivot;
+				PreviousUpper = Upper[i];
+			}
+
+			// Back substitution
+			for (int32 i = NumSticks - 2; i >= 0; i--)
+			{
+				Lambdas[i] -= Upper[i] * Lambdas[i + 1];
+			}
+
+			// Each free point moves by its sticks' normals scaled by their multipliers, pulling in from either side
+			for (int32 i = 0; i <= LastIndex; i++)
+			{
+				if (IsPinned(Points, i, LastIndex))
+				{
+					continue;
+				}
+
+				FVectorType Correction = FVectorType::ZeroVector;
+				if (i > 0)
+				{
+					Correction += Normals[i - 1] * Lambdas[i - 1];
+				}
+				if (i < NumSticks)
+				{
+					Correction -= Normals[i] * Lambdas[i];
+				}
+				Points[i].Position += Correction;
+			}
+		}
+
+		/**
+		 * Long range attachments: every free point gets a tether to its nearest pin along the chain, as long as the sticks
+		 * between them. Relaxing sticks only moves a pin's pull one stick along per pass, so a long chain hanging from its
+		 * pins sags past its rest length unless it gets lots of passes. A tether just stops the point going too far, in one go.
+		 */
+		static void BuildTethers(const FVerletPoint* Points, const FVerletStick* Sticks, int32 LastIndex, TArray<int32, TMemStackAllocator<>>& OutAnchors, TArray<float, TMemStackAllocator<>>& OutLengths)
+		{
+			OutAnchors.SetNumUninitialized(LastIndex + 1);
+			OutLengths.SetNumUninitialized(LastIndex + 1);
+
+			// Nearest pin behind each point, then swap in the nearest one ahead if it's closer
+			int32 Anchor = INDEX_NONE;
+			float Length = 0.f;
+			for (int32 i = 0; i <= LastIndex; i++)
+			{
+				Length += i > 0 ? Sticks[i - 1].DesiredLength : 0.f;
+				if (IsPinned(Points, i, LastIndex))
+				{
+					Anchor = i;
+					Length = 0.f;
+				}
+				OutAnchors[i] = Anchor;
+				OutLengths[i] = Anchor != INDEX_NONE ? Length : FLT_MAX;
+			}
+
+			Anchor = INDEX_NONE;
+			Length = 0.f;
+			for (int32 i = LastIndex; i >= 0; i--)
+			{
+				Length += i < LastIndex ? Sticks[i].DesiredLength : 0.f;
+				if (IsPinned(Points, i, LastIndex))
+				{
+					Anchor = i;
+					Length = 0.f;
+				}
+				if (Anchor != INDEX_NONE && Length < OutLengths[i])
+				{
+					OutAnchors[i] = Anchor;
+					OutLengths[i] = Length;
+				}
+			}
+		}
+
+		static void ApplyTethers(const FVerletChain& Chain, FVerletPoint* RESTRICT Points, const int32* Anchors, const float* Lengths)
+		{
+			ForEachFreePoint(Chain, [&](int32 i)
+			{
+				const FVectorType& AnchorPosition = Points[Anchors[i]].Position;
+				const FVectorType Delta = Points[i].Position - AnchorPosition;
+				const float DistanceSquared = Delta.SizeSquared();
+				if (DistanceSquared > FMath::Square(Lengths[i]))
+				{
+					Points[i].Position = AnchorPosition + Delta * (Lengths[i] * FMath::InvSqrtEst(DistanceSquared));
+				}
+			});
+		}
+
+		/**
+		 * The active sticks, packed so the relax pass doesn't need to look at the pins.
+		 *
+		 * XPBD gives each stick a Lagrange multiplier for the substep and turns its compliance into a resistance to that
+		 * multiplier growing, so the sticks end up as stiff as their compliance says rather than stiffer the more passes
+		 * they get. With a single pass each substep the multiplier always starts at zero, and the XPBD correction comes out
+		 * the same as the relax one with each end's share scaled down to Weight / (Weight0 + Weight1 + Alpha). So XPBD is
+		 * just the relax pass over sticks packed with their compliance.
+		 */
+		static void BuildPackedSticks(const FVerletChain& Chain, float SubDeltaTime, bool bUseCompliance, TArray<FPackedStick, TMemStackAllocator<>>& OutSticks)
+		{
+			const FVerletPoint* Points = Chain.Points.GetData();
+			const int32 LastIndex = Chain.Points.Num() - 1;
+			const float InvSubDeltaTimeSquared = 1.f / (SubDeltaTime * SubDeltaTime);
+			OutSticks.Reserve(Chain.Sticks.Num());
+			auto AddStick = [&](int32 StickIndex)
+			{
+				const FVerletStick& Stick = Chain.Sticks[StickIndex];
+				const float Weight0 = IsPinned(Points, Stick.Point0Index, LastIndex) ? 0.f : 1.f;
+				const float Weight1 = IsPinned(Points, Stick.Point1Index, LastIndex) ? 0.f : 1.f;
+				const float Alpha = bUseCompliance ? Stick.Compliance * InvSubDeltaTimeSquared : 0.f;
+				const float InvTotal = 1.f / (Weight0 + Weight1 + Alpha);
+				OutSticks.Add({ Stick.Point0Index, Stick.Point1Index, Stick.DesiredLength, Weight0 * InvTotal, Weight1 * InvTotal });
+			};
+
+			if (!Chain.bIsSingleRun)
+			{
+				ForEachActiveStick(Chain, AddStick);
+				return;
+			}
+
+			// Red/black order: in a single run only neighbouring sticks share a point, so the even sticks are all independent
+			// of each other and so are the odd ones. Doing all of one then all of the other leaves no stick waiting on the one
+			// before it, and the CPU can overlap them.
+			for (int32 Parity = 0; Parity < 2; Parity++)
+			{
+				ForEachActiveStick(Chain, [&](int32 StickIndex)
+				{
+					if ((StickIndex & 1) == Parity)
+					{
+						AddStick(StickIndex);
+					}
+				});
+			}
+		}
+
+		static void Solve(FVerletChain& Chain, float DeltaTime, int32 RuntimeSubsteps, const FSolveSettings& Settings)
+		{
+			const int32 Substeps = CompileTimeSubsteps > 0 ? CompileTimeSubsteps : RuntimeSubsteps;
+			const float SubDeltaTime = DeltaTime / Substeps;
+			const FVectorType GravityStep = Chain.Gravity * SubDeltaTime * SubDeltaTime;
+
+			FVerletPoint* RESTRICT Points = Chain.Points.GetData();
+			FVerletStick* RESTRICT Sticks = Chain.Sticks.GetData();
+			const int32 NumPoints = Chain.Points.Num();
+			const int32 NumSticks = Chain.Sticks.Num();
+			const int32 LastIndex = NumPoints - 1;
+			const float Friction = Settings.Friction;
+			const EVerletStickSolver StickSolver = Settings.StickSolver;
+
+			// Pins don't move during an update, so the tethers only need working out once
+			FMemMark Mark(FMemStack::Get());
+			TArray<int32, TMemStackAllocator<>> TetherAnchors;
+			TArray<float, TMemStackAllocator<>> TetherLengths;
+			const bool bTethers = Pinning != EVerletPinning::None && Settings.bTethers;
+			if (bTethers)
+			{
+				BuildTethers(Points, Sticks, LastIndex, TetherAnchors, TetherLengths);
+			}
+
+			TArray<FPackedStick, TMemStackAllocator<>> PackedSticks;
+			if (StickSolver != EVerletStickSolver::Direct)
+			{
+				BuildPackedSticks(Chain, SubDeltaTime, StickSolver == EVerletStickSolver::XPBD, PackedSticks);
+			}
+			const int32 NumPackedSticks = PackedSticks.Num();
+
+			for (int32 Substep = 0; Substep < Substeps; Substep++)
+			{
+				// Gravity and integration in one pass, same as Accelerate then UpdatePosition on each point
+				ForEachFreePoint(Chain, [&](int32 i)
+				{
+					FVerletPoint& Point = Points[i];
+					const FVectorType Velocity = (Point.Position - Point.LastPosition) * Friction;
+					Point.LastPosition = Point.Position;
+					Point.Position += Velocity + GravityStep + Point.Acceleration * SubDeltaTime * SubDeltaTime;
+					Point.Acceleration = FVectorType::ZeroVector;
+				});
+
+				if (bTethers)
+				{
+					ApplyTethers(Chain, Points, TetherAnchors.GetData(), TetherLengths.GetData());
+				}
+
+				if (StickSolver == EVerletStickSolver::Direct)
+				{
+					SolveSticksDirect(Points, Sticks, NumSticks, LastIndex);
+					continue;
+				}
+
+				// Same as FVerletStick::ConstrainLength, but branch free over the packed sticks
+				for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+				{
+					for (int32 i = 0; i < NumPackedSticks; i++)
+					{
+						const FPackedStick& Stick = PackedSticks[i];
+						FVerletPoint& Point0 = Points[Stick.Point0Index];
+						FVerletPoint& Point1 = Points[Stick.Point1Index];
+
+						const FVectorType Delta = Point1.Position - Point0.Position;
+						const FVectorType Offset = Delta * FVerletStick::GetCorrectionScale(Delta, Stick.DesiredLength);
+						Point0.Position -= Offset * Stick.Share0;
+						Point1.Position += Offset * Stick.Share1;
+					}
+				}
+			}
+		}
+	};
+
+	template <int32 Iterations, EVerletPinning Pinning, int32 SubstepMultiplier = 1>
+	static void SolveWithIterations(FVerletChain& Chain, float DeltaTime, int32 Substeps, const FSolveSettings& Settings)
+	{
+		switch (Substeps)
+		{
+		case FVerletChain::DefaultSubsteps:
+			TChainSolver<FVerletChain::DefaultSubsteps * SubstepMultiplier, Iterations, Pinning>::Solve(Chain, DeltaTime, Substeps * SubstepMultiplier, Settings);
+			break;
+		case FVerletChain::ReducedSubsteps:
+			TChainSolver<FVerletChain::ReducedSubsteps * SubstepMultiplier, Iterations, Pinning>::Solve(Chain, DeltaTime, Substeps * SubstepMultiplier, Settings);
+			break;
+		default:
+			TChainSolver<0, Iterations, Pinning>::Solve(Chain, DeltaTime, Substeps * SubstepMultiplier, Settings);
+			break;
+		}
+	}
+
+	template <EVerletPinning Pinning>
+	static void SolveWithPinning(FVerletChain& Chain, float DeltaTime, int32 Substeps, const FSolveSettings& Settings)
+	{
+		if (Settings.StickSolver == EVerletStickSolver::XPBD)
+		{
+			static_assert(FVerletChain::NumXPBDIterations == 1, "XPBD sticks are packed for a single pass each substep, see BuildPackedSticks");
+			// Friction is applied every substep, so it's spread over the extra ones to damp the same amount per update
+			FSolveSettings XPBDSettings = Settings;
+			XPBDSettings.Friction = FMath::Pow(Settings.Friction, 1.f / FVerletChain::XPBDSubstepMultiplier);
+			SolveWithIterations<FVerletChain::NumXPBDIterations, Pinning, FVerletChain::XPBDSubstepMultiplier>(Chain, DeltaTime, Substeps, XPBDSettings);
+		}
+		else if (Pinning != EVerletPinning::None && Settings.bTethers)
+		{
+			SolveWithIterations<FVerletChain::NumTetheredIterations, Pinning>(Chain, DeltaTime, Substeps, Settings);
+		}
+		else
+		{
+			SolveWithIterations<FVerletChain::NumIterations, Pinning>(Chain, DeltaTime, Substeps, Settings);
+		}
+	}
+}
+
+void FVerletChain::RebuildActiveLists()
+{
+	bPinsChanged = false;
+	bIsSingleRun = VerletSolver::IsSingleRun(Sticks, Points.Num());
+
+	const int32 LastIndex = Points.Num() - 1;
+	bool bOnlyEndsPinned = LastIndex >= 1 && Points[0].bIsPinned && Points[LastIndex].bIsPinned;
+
+	ActivePoints.Reset();
+	for (int32 i = 0; i <= LastIndex; i++)
+	{
+		FVerletPoint& Point = Points[i];
+		if (Point.bIsPinned)
+		{
+			// Pinned points are skipped from here on, so don't let anything they were given linger until they're unpinned
+			Point.Acceleration = FVectorType::ZeroVector;
+			bOnlyEndsPinned &= i == 0 || i == LastIndex;
+		}
+		else
+		{
+			ActivePoints.Add(i);
+		}
+	}
+
+	ActiveSticks.Reset();
+	for (int32 i = 0; i < Sticks.Num(); i++)
+	{
+		if (!Points[Sticks[i].Point0Index].bIsPinned || !Points[Sticks[i].Point1Index].bIsPinned)
+		{
+			ActiveSticks.Add(i);
+		}
+	}
+
+	const bool bAnyPinned = ActivePoints.Num() != Points.Num();
+	Pinning = !bAnyPinned ? EVerletPinning::None : bOnlyEndsPinned ? EVerletPinning::Ends : EVerletPinning::Arbitrary;
+}
+
+const float FVerletChain::MaxDeltaTime = 1.0f / 30.f;
+
+void FVerletChain::Update(float DeltaTime, int32 Substeps)
+{
+	DeltaTime = FMath::Min(MaxDeltaTime, DeltaTime);
+	Age += DeltaTime;
+
+	float TimeSinceCreated = GetSecondsSinceCreated();
+	if (TimeSinceCreated > SecondsBeforeBreaking && !bHasBroken)
+	{
+		SetAllPinned(false);
+		bHasBroken = true;
+	}
+
+	Substeps = FMath::Max(Substeps, 1);
+
+	if (bPinsChanged)
+	{
+		RebuildActiveLists();
+	}
+
+	using namespace VerletSolver;
+
+	// Read once up front, rather than once per point per substep
+	FSolveSettings Settings;
+	Settings.Friction = WireFriction;
+	Settings.StickSolver = (EVerletStickSolver)FMath::Clamp(ChainSolver, 0, (int32)EVerletStickSolver::XPBD);
+	if (Settings.StickSolver == EVerletStickSolver::Direct && !bIsSingleRun)
+	{
+		Settings.StickSolver = EVerletStickSolver::Relax;
+	}
+	// The direct solve already holds every stick exactly, so tethers wouldn't add anything
+	Settings.bTethers = ChainTethers != 0 && bIsSingleRun && Settings.StickSolver != EVerletStickSolver::Direct;
+
+	switch (Pinning)
+	{
+	case EVerletPinning::None:
+		SolveWithPinning<EVerletPinning::None>(*this, DeltaTime, Substeps, Settings);
+		break;
+	case EVerletPinning::Ends:
+		SolveWithPinning<EVerletPinning::Ends>(*this, DeltaTime, Substeps, Settings);
+		break;
+	default:
+		SolveWithPinning<EVerletPinning::Arbitrary>(*this, DeltaTime, Substeps, Settings);
+		break;
+	}
+}
@@ -1,18 +1,34 @@
 ﻿#pragma once
 
-#include "WibblyWires.h"
+#include "CoreMinimal.h"
+#include "WibblyTypes.h"
+#include "WibblyWiresStats.h"
 
-#if ENGINE_MAJOR_VERSION >= 5 && ENGINE_MINOR_VERSION >= 1
-typedef FVector2f FVectorType;
-typedef FBox2f FBoxType;
-#else
-typedef FVector2D FVectorType;
-typedef FBox2D FBoxType;
-#endif
+// Chain physics only depends on Core, so it can be stepped from any thread (or outside the editor entirely)
 
 extern float WireFriction;
 extern float SecondsBeforeBreaking;
 extern float WireShrinkRate;
+extern int32 ChainSolver;
+extern int32 ChainTethers;
+extern float StickCompliance;
+
+// Which points of a chain are pinned, so the solver can work it out from the index instead of checking every point
+enum class EVerletPinning : uint8
+{
+	None,
+	// Just the first and last point, as a wire still attached to both of its pins
+	Ends,
+	Arbitrary,
+};
+
+// Ways FVerletChain can keep its sticks at length, picked with WibblyWires.ChainSolver
+enum class EVerletStickSolver : uint8
+{
+	Relax,
+	Direct,
+	XPBD,
+};
 
 struct FVerletPoint
 {
@@ -62,26 +78,44 @@ struct FVerletStick
 	int32 Point0Index;
 	int32 Point1Index;
 	float DesiredLength;
+	// Inverse stiffness for the XPBD solver
+	float Compliance;
 
 	FVerletStick() = delete;
 
-	FVerletStick(int32 InPoint0, int32 InPoint1, float InDesiredLength)
+	FVerletStick(int32 InPoint0, int32 InPoint1, float InDesiredLength, float InCompliance = 0.f)
 		: Point0Index(InPoint0)
 		, Point1Index(InPoint1)
 		, DesiredLength(InDesiredLength)
+		, Compliance(InCompliance)
 	{
 	}
 
+	/**
+	 * How much of Delta to add to bring it back to DesiredLength, i.e. (DesiredLength - Length) / Length, with an
+	 * estimated reciprocal sqrt (rsqrt plus a Newton step) instead of a sqrt and a divide. Points that have collapsed
+	 * onto each other (which ShrinkSticks does on purpose) have no direction to push apart in, so the length is clamped
+	 * to get a finite scale on a zero Delta rather than a NaN.
+	 */
+	static FORCEINLINE float GetCorrectionScale(const FVectorType& Delta, float DesiredLength)
+	{
+		const float InvLength = FMath::InvSqrtEst(FMath::Max(Delta.SizeSquared(), KINDA_SMALL_NUMBER));
+		return DesiredLength * InvLength - 1.f;
+	}
+
 	void ConstrainLength(FVerletPoint& Point0, FVerletPoint& Point1)
 	{
+		// Nothing to move, so don't waste a sqrt on it
+		if (Point0.bIsPinned && Point1.bIsPinned)
+		{
+			return;
+		}
+
 		FVectorType Delta = Point1.Position - Point0.Position;
-		float CurrentLength = Delta.Size();
-		float Difference = DesiredLength - CurrentLength;
-		float HalfPercent = (Difference / CurrentLength) * 0.5f;
+		float HalfPercent = GetCorrectionScale(Delta, DesiredLength) * 0.5f;
 		FVectorType HalfOffset = Delta * HalfPercent;
 
 		// If either is pinned, the the other will need to cover the full adjustment
-		// If both are pinned then this will be wasted, but not micro-optimizing yet
 		if (Point0.bIsPinned || Point1.bIsPinned)
 		{
 			HalfOffset *= 2.f;
@@ -107,20 +141,43 @@ struct FVerletChain
 	FLinearColor LineColor;
 	float LineThickness;
 	bool bHasFullyShrunk = false;
-	float CreationTime;
+	// Simulated seconds since the chain was made, so it doesn't depend on any particular clock
+	float Age = 0.f;
 	bool bHasBroken = false;
+	// Time this chain has missed out on while time-sliced
+	float PendingDeltaTime = 0.f;
+
+	// What the solver knows about the chain's pins, rebuilt by Update after MarkPinsChanged.
+	// The active lists are the points that aren't pinned and the sticks with at least one end that isn't.
+	EVerletPinning Pinning = EVerletPinning::None;
+	bool bIsSingleRun = false;
+	TArray<int32> ActivePoints;
+	TArray<int32> ActiveSticks;
+
+	static const int32 DefaultSubsteps = 10;
+	static const int32 ReducedSubsteps = 3;
+	// How many times the sticks are relaxed each substep
+	static const int32 NumIterations = 5;
+	// XPBD converges better over small substeps than over repeated passes, so it takes twice the substeps with a single
+	// pass each. That's fewer stick passes than Relax makes, and it holds length a little better.
+	static const int32 NumXPBDIterations = 1;
+	static const int32 XPBDSubstepMultiplier = 2;
+	// Tethers keep pinned chains from stretching, which is most of what the extra passes were for
+	static const int32 NumTetheredIterations = 3;
+	// Longest step Update will take in one go, anything more is dropped
+	static const float MaxDeltaTime;
 
 	FVerletChain(FLinearColor InLineColor, float InLineThickness)
 	{
 		LineColor = InLineColor;
 		LineThickness = InLineThickness;
-		CreationTime = FSlateApplication::Get().GetCurrentTime();
 	}
 
 	// Adds a new point and automatically connects it to the previous point with a stick
 	void AddToChain(FVectorType NewPoint, bool bIsPinned = false)
 	{
 		Points.Add(FVerletPoint(NewPoint, bIsPinned));
+		MarkPinsChanged();
 
 		int32 PointCount = Points.Num();
 		if (PointCount >= 2)
@@ -130,7 +187,7 @@ struct FVerletChain
 			FVerletPoint P0 = Points[P0Index];
 			FVerletPoint P1 = Points[P1Index];
 			float DesiredLength = FVectorType::Distance(P0.Position, P1.Position);
-			Sticks.Add(FVerletStick(P0Index, P1Index, DesiredLength));
+			Sticks.Add(FVerletStick(P0Index, P1Index, DesiredLength, StickCompliance));
 		}
 	}
 
@@ -163,41 +220,23 @@ struct FVerletChain
 		{
 			Point.bIsPinned = bIsPinned;
 		}
+		MarkPinsChanged();
 	}
 
-	float GetSecondsSinceCreated() const
+	// Anything that changes a point's bIsPinned (or adds points or sticks) directly needs to call this
+	void MarkPinsChanged()
 	{
-		return FSlateApplication::Get().GetCurrentTime() - CreationTime;
+		bPinsChanged = true;
 	}
 
-	void Update(float DeltaTime)
+	float GetSecondsSinceCreated() const
 	{
-		static const float MaxDeltaTime = 1.0f / 30.f;
-		DeltaTime = FMath::Min(MaxDeltaTime, DeltaTime);
-
-		float TimeSinceCreated = GetSecondsSinceCreated();
-		if (TimeSinceCreated > SecondsBeforeBreaking && !bHasBroken)
-		{
-			SetAllPinned(false);
-			bHasBroken = true;
-		}
-
-		const int32 Substeps = 10;
-		float SubDeltaTime = DeltaTime / Substeps;
-		for (int32 i = 0; i < Substeps; i++)
-		{
-			ApplyGravity();
-
-			UpdatePositions(SubDeltaTime);
-
-			for (int32 j = 0; j < 5; j++)
-			{
-				ApplyConstraints();
-				ApplyCollisions();
-			}
-		}
+		return Age;
 	}
 
+	// Steps the chain with whichever solver in Verlet.cpp is specialised for the substep count and how its points are pinned
+	void Update(float DeltaTime, int32 Substeps = DefaultSubsteps);
+
 	FBoxType CalcBounds() const
 	{
 		FBoxType Bounds(EForceInit::ForceInitToZero);
@@ -211,6 +250,9 @@ struct FVerletChain
 	}
 
 private:
+	bool bPinsChanged = true;
+
+	void RebuildActiveLists();
 
 	void ShrinkSticks(float DeltaTime)
 	{
@@ -223,6 +265,10 @@ private:
 			if (Stick.DesiredLength < 1.f)
 			{
 				Stick.DesiredLength = 0.1f;
+				if (!Points[Stick.Point0Index].bIsPinned || !Points[Stick.Point1Index].bIsPinned)
+				{
+					MarkPinsChanged();
+				}
 				Points[Stick.Point0Index].bIsPinned = true;
 				Points[Stick.Point1Index].bIsPinned = true;
 				Points[Stick.Point1Index].Position = Points[Stick.Point0Index].Position;
@@ -235,55 +281,113 @@ private:
 			}
 		}
 	}
+};
 
-	void UpdatePositions(float DeltaTime)
+class FVerletState
+{
+public:
+	void TranslateVerletChains(FVectorType Translation)
 	{
-		for (FVerletPoint& Point : Points)
+		for (FVerletChain& Chain : VerletChains)
 		{
-			Point.UpdatePosition(DeltaTime);
+			Chain.Translate(Translation);
 		}
 	}
 
-	void ApplyConstraints()
+	FVerletChain& AddChain(FVerletChain&& Chain)
 	{
-		for (FVerletStick& Stick : Sticks)
-		{
-			Stick.ConstrainLength(Points[Stick.Point0Index], Points[Stick.Point1Index]);
-		}
+		return VerletChains.Add_GetRef(MoveTemp(Chain));
 	}
 
-	void ApplyCollisions()
+	const TArray<FVerletChain>& GetChains() const
 	{
-		// Nothing for now
+		return VerletChains;
 	}
 
-	void ApplyGravity()
+	int32 GetNumChains() const
 	{
-		for (FVerletPoint& Point : Points)
+		return VerletChains.Num();
+	}
+
+	int32 GetNumPoints() const
+	{
+		int32 NumPoints = 0;
+		for (const FVerletChain& Chain : VerletChains)
 		{
-			Point.Accelerate(Gravity);
+			NumPoints += Chain.Points.Num();
 		}
+
+		return NumPoints;
 	}
-};
 
-class FVerletState
-{
-public:
-	void TranslateVerletChains(FVectorType Translation)
+	SIZE_T GetAllocatedSize() const
 	{
+		SIZE_T AllocatedSize = VerletChains.GetAllocatedSize();
+		for (const FVerletChain& Chain : VerletChains)
+		{
+			AllocatedSize += Chain.Points.GetAllocatedSize() + Chain.Sticks.GetAllocatedSize();
+			AllocatedSize += Chain.ActivePoints.GetAllocatedSize() + Chain.ActiveSticks.GetAllocatedSize();
+		}
+
+		return AllocatedSize;
+	}
+
+	void UpdateVerletChains(float DeltaTime, int32 Substeps = FVerletChain::DefaultSubsteps)
+	{
+		WIBBLY_SCOPE(STAT_WibblyWires_UpdateVerletChains);
+		INC_DWORD_STAT_BY(STAT_WibblyWires_ChainsAlive, VerletChains.Num());
+
 		for (FVerletChain& Chain : VerletChains)
 		{
-			Chain.Translate(Translation);
+			Chain.Update(DeltaTime, Substeps);
+			INC_DWORD_STAT_BY(STAT_WibblyWires_PointsSimulated, Chain.Points.Num());
 		}
+
+		RemoveExpiredChains();
 	}
 
-	void UpdateVerletChains(float DeltaTime)
+	// Updates as many chains as fit before DeadlineSeconds, carrying on round-robin from wherever the last call got to.
+	// Chains that miss out accumulate their time for when their turn comes, and catch up on it in steps of at most
+	// FVerletChain::MaxDeltaTime so none of it is clamped away. Returns whether every chain was updated.
+	bool UpdateVerletChainsTimeSliced(float DeltaTime, int32 Substeps, double DeadlineSeconds)
 	{
+		WIBBLY_SCOPE(STAT_WibblyWires_UpdateVerletChains);
+		INC_DWORD_STAT_BY(STAT_WibblyWires_ChainsAlive, VerletChains.Num());
+
 		for (FVerletChain& Chain : VerletChains)
 		{
-			Chain.Update(DeltaTime);
+			Chain.PendingDeltaTime += DeltaTime;
+		}
+
+		const int32 NumChains = VerletChains.Num();
+		int32 NumUpdated = 0;
+		for (; NumUpdated < NumChains; NumUpdated++)
+		{
+			// Always make some progress, even if we were over budget before we started
+			if (NumUpdated > 0 && FPlatformTime::Seconds() > DeadlineSeconds)
+			{
+				break;
+			}
+
+			FVerletChain& Chain = VerletChains[(NextTimeSlicedChain + NumUpdated) % NumChains];
+			while (Chain.PendingDeltaTime > 0.f)
+			{
+				const float ChainDeltaTime = FMath::Min(Chain.PendingDeltaTime, FVerletChain::MaxDeltaTime);
+				Chain.Update(ChainDeltaTime, Substeps);
+				Chain.PendingDeltaTime -= ChainDeltaTime;
+			}
+			INC_DWORD_STAT_BY(STAT_WibblyWires_PointsSimulated, Chain.Points.Num());
 		}
 
+		NextTimeSlicedChain = NumChains > 0 ? (NextTimeSlicedChain + NumUpdated) % NumChains : 0;
+
+		RemoveExpiredChains();
+
+		return NumUpdated == NumChains;
+	}
+
+	void RemoveExpiredChains()
+	{
 		// Delete any chains that are entirely below the bottom of the screen
 		VerletChains.RemoveAllSwap([](const FVerletChain& Chain)
 		{
@@ -302,43 +406,7 @@ public:
 		});
 	}
 
-	void RenderVerletChains(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, float ThicknessScale)
-	{
-		int32 MaxPointCount = 0;
-
-		for (const FVerletChain& Chain : VerletChains)
-		{
-			MaxPointCount = FMath::Max(MaxPointCount, Chain.Points.Num());
-		}
-
-		// Re-use this array between graphs and frames to save on allocations
-		static TArray<FVectorType> Points;
-		Points.Reserve(MaxPointCount);
-
-		for (const FVerletChain& Chain : VerletChains)
-		{
-			Points.Reset();
-
-			for (const FVerletPoint& Point : Chain.Points)
-			{
-				Points.Add(Point.Position);
-			}
-
-			float Opacity = FMath::Clamp(1.f - ((Chain.GetSecondsSinceCreated() - 1.f) / 1.f), 0.f, 1.f);
-
-			// TODO: Catmull-Rom spline through these points so can get away with fewer segments
-			FSlateDrawElement::MakeLines(
-				OutDrawElements,
-				LayerId,
-				FPaintGeometry(),
-				Points,
-				ESlateDrawEffect::NoPixelSnapping,
-				Chain.LineColor.CopyWithNewOpacity(Opacity),
-				true, // bAntiAlias
-				Chain.LineThickness * ThicknessScale);
-		}
-	}
-
 private:
 	TArray<FVerletChain> VerletChains;
+	int32 NextTimeSlicedChain = 0;
 };
\ No newline at end of file
@@ -0,0 +1,468 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WibblyBenchmarks.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Verlet.h"
+#include "WibblyConnectionDrawingPolicy.h"
+#include "WireCurve.h"
+#include "WireState.h"
+
+namespace WibblyBenchmarks
+{
+	FCountingMalloc& FCountingMalloc::Get()
+	{
+		// Deliberately leaked, see above. Benchmarks only run from the game thread, so installing it here doesn't race
+		// with another install, and allocations already in flight on other threads are fine to free through the proxy.
+		static FCountingMalloc* CountingMalloc = [] {
+			check(IsInGameThread());
+			FCountingMalloc* Proxy = new FCountingMalloc(GMalloc);
+			GMalloc = Proxy;
+			return Proxy;
+		}();
+		return *CountingMalloc;
+	}
+
+	FScopedAllocationCounter::FScopedAllocationCounter()
+	{
+		FCountingMalloc& CountingMalloc = FCountingMalloc::Get();
+		if (!CountingMalloc.BeginCounting())
+		{
+			return;
+		}
+
+		void* Probe = FMemory::Malloc(16);
+		FMemory::Free(Probe);
+		bIsCounting = CountingMalloc.GetNumAllocations() > 0;
+		if (bIsCounting)
+		{
+			CountingMalloc.ResetCount();
+		}
+		else
+		{
+			CountingMalloc.EndCounting();
+		}
+	}
+
+	FScopedAllocationCounter::~FScopedAllocationCounter()
+	{
+		if (bIsCounting)
+		{
+			FCountingMalloc::Get().EndCounting();
+		}
+	}
+
+	struct FRunner
+	{
+		FString Filter;
+		TArray<FResult> Results;
+
+		// Runs Op until it's had enough time to give a stable number, where each op processes ItemsPerOp points/wires/samples.
+		// Returns the result so callers can add to it, or null if the filter skipped it.
+		FResult* Run(const TCHAR* Name, int32 Size, int32 ItemsPerOp, TFunctionRef<void()> Op)
+		{
+			if (!Filter.IsEmpty() && !FString(Name).Contains(Filter))
+			{
+				return nullptr;
+			}
+
+			const double MinSeconds = 0.1;
+			const int32 MinOps = 5;
+			const int32 MaxOps = 1000;
+
+			// Warm up first so one-off growth of scratch arrays doesn't count against every op
+			Op();
+
+			int32 NumOps = 0;
+			double ElapsedSeconds = 0.0;
+			double NumAllocations = 0.0;
+			{
+				FScopedAllocationCounter AllocationCounter;
+				const double StartTime = FPlatformTime::Seconds();
+				do
+				{
+					Op();
+					NumOps++;
+					ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+				}
+				while ((ElapsedSeconds < MinSeconds || NumOps < MinOps) && NumOps < MaxOps);
+				NumAllocations = AllocationCounter.GetNumAllocations();
+			}
+
+			FResult& Result = Results.AddDefaulted_GetRef();
+			Result.Name = Name;
+			Result.Size = Size;
+			Result.NumOps = NumOps;
+			Result.NsPerOp = ElapsedSeconds * 1e9 / NumOps;
+			Result.ItemsPerSecond = ElapsedSeconds > 0.0 ? (double)ItemsPerOp * NumOps / ElapsedSeconds : 0.0;
+			Result.AllocationsPerOp = NumAllocations >= 0.0 ? NumAllocations / NumOps : -1.0;
+			return &Result;
+		}
+	};
+
+	// Somewhere for results to go so the compiler can't optimize away the work that made them
+	static volatile float ResultSink = 0.f;
+
+	static FVerletChain MakeChain(int32 NumPoints, FVectorType Origin)
+	{
+		FVerletChain Chain(FLinearColor::White, 2.f);
+		for (int32 i = 0; i < NumPoints; i++)
+		{
+			const bool bIsPinned = i == 0 || i == NumPoints - 1;
+			Chain.AddToChain(Origin + FVectorType(i * 5.f, 0.f), bIsPinned);
+		}
+
+		// Keep the ends pinned for good, otherwise chains fall off screen partway through and the workload changes
+		Chain.bHasBroken = true;
+		return Chain;
+	}
+
+	static double CalcLengthError(const FVerletChain& Chain)
+	{
+		double TotalError = 0.0;
+		for (const FVerletStick& Stick : Chain.Sticks)
+		{
+			const float Length = FVectorType::Distance(Chain.Points[Stick.Point0Index].Position, Chain.Points[Stick.Point1Index].Position);
+			TotalError += FMath::Abs(Length - Stick.DesiredLength) / FMath::Max(Stick.DesiredLength, SMALL_NUMBER);
+		}
+
+		return Chain.Sticks.Num() > 0 ? TotalError / Chain.Sticks.Num() : 0.0;
+	}
+
+	static void MakeWireEndpoints(FRandomStream& Random, FVectorType& OutStart, FVectorType& OutEnd)
+	{
+		OutStart = FVectorType(Random.FRandRange(0.f, 2000.f), Random.FRandRange(0.f, 2000.f));
+		OutEnd = OutStart + FVectorType(Random.FRandRange(50.f, 600.f), Random.FRandRange(-300.f, 300.f));
+	}
+
+	static void RunAll(FRunner& Runner)
+	{
+		const float DeltaTime = 1.f / 60.f;
+
+		for (int32 NumPoints : { 10, 100, 1000 })
+		{
+			// Same chain through each stick solver, so the time each takes can be weighed against how well it holds lengths
+			const int32 PreviousChainSolver = ChainSolver;
+			const TCHAR* SolverNames[] = { TEXT("VerletChain.Update"), TEXT("VerletChain.UpdateDirect"), TEXT("VerletChain.UpdateXPBD") };
+			double RelaxLengthError = -1.0;
+			double RelaxNsPerOp = -1.0;
+			for (int32 Solver = 0; Solver < UE_ARRAY_COUNT(SolverNames); Solver++)
+			{
+				ChainSolver = Solver;
+				FVerletChain Chain = MakeChain(NumPoints, FVectorType(0.f, 0.f));
+				FResult* Result = Runner.Run(SolverNames[Solver], NumPoints, NumPoints, [&Chain, DeltaTime]()
+				{
+					Chain.Update(DeltaTime);
+				});
+
+				if (Result)
+				{
+					Result->LengthError = CalcLengthError(Chain);
+					if (Solver == (int32)EVerletStickSolver::Relax)
+					{
+						RelaxLengthError = Result->LengthError;
+						RelaxNsPerOp = Result->NsPerOp;
+					}
+					else
+					{
+						Result->RelaxLengthError = RelaxLengthError;
+						Result->RelaxNsPerOp = RelaxNsPerOp;
+					}
+				}
+			}
+			ChainSolver = PreviousChainSolver;
+
+			FVerletChain StickChain = MakeChain(NumPoints, FVectorType(0.f, 0.f));
+			Runner.Run(TEXT("VerletStick.ConstrainLength"), NumPoints, StickChain.Sticks.Num(), [&StickChain]()
+			{
+				for (FVerletStick& Stick : StickChain.Sticks)
+				{
+					Stick.ConstrainLength(StickChain.Points[Stick.Point0Index], StickChain.Points[Stick.Point1Index]);
+				}
+			});
+		}
+
+		for (int32 NumChains : { 1, 10, 100, 1000 })
+		{
+			const int32 PointsPerChain = 20;
+			FVerletState VerletState;
+			for (int32 i = 0; i < NumChains; i++)
+			{
+				VerletState.AddChain(MakeChain(PointsPerChain, FVectorType((i % 10) * 150.f, (i / 10) * 10.f)));
+			}
+
+			Runner.Run(TEXT("VerletState.UpdateVerletChains"), NumChains, NumChains * PointsPerChain, [&VerletState, DeltaTime]()
+			{
+				VerletState.UpdateVerletChains(DeltaTime);
+			});
+		}
+
+		for (int32 NumWires : { 100, 1000, 5000, 20000 })
+		{
+			FRandomStream Random(NumWires);
+			TArray<FVectorType> Starts;
+			TArray<FVectorType> Ends;
+			TArray<FWireState> WireStates;
+			TArray<FWireDrawCache> DrawCaches;
+			TArray<FWireCurve> Curves;
+			for (int32 i = 0; i < NumWires; i++)
+			{
+				FVectorType Start, End;
+				MakeWireEndpoints(Random, Start, End);
+				Starts.Add(Start);
+				Ends.Add(End);
+
+				FWireState& WireState = WireStates.Emplace_GetRef(Start, End, FWireParams::FromHash(i, false));
+				const FVectorType CenterPoint = WireState.CenterPoint;
+				Curves.Emplace(Start, (CenterPoint - Start) * 1.3f, End, (End - CenterPoint) * 1.3f);
+			}
+			DrawCaches.SetNum(NumWires);
+
+			// Wiggle one end back and forth so the springs always have something to do.
+			// Params are derived inside the loop, same as the simulation does.
+			int32 Frame = 0;
+			Runner.Run(TEXT("WireState.Update"), NumWires, NumWires, [&, DeltaTime]()
+			{
+				const FVectorType Wiggle(0.f, (Frame++ % 2) ? 10.f : -10.f);
+				for (int32 i = 0; i < WireStates.Num(); i++)
+				{
+					WireStates[i].SetTargets(Starts[i] + Wiggle, Ends[i]);
+					WireStates[i].Update(DeltaTime, FWireParams::FromHash(i, false));
+				}
+			});
+
+			Runner.Run(TEXT("WireDrawCache.Tessellate"), NumWires, NumWires, [&]()
+			{
+				for (int32 i = 0; i < Curves.Num(); i++)
+				{
+					DrawCaches[i].Tessellate(Curves[i]);
+				}
+			});
+
+			const int32 NumStepsToTest = 16;
+			const FVectorType MousePosition(1000.f, 1000.f);
+			float TotalDistance = 0.f;
+			Runner.Run(TEXT("WireCurve.FindClosestPoint"), NumWires, NumWires * NumStepsToTest, [&]()
+			{
+				FVectorType ClosestPoint;
+				for (const FWireCurve& Curve : Curves)
+				{
+					TotalDistance += Curve.FindClosestPoint(MousePosition, NumStepsToTest, ClosestPoint);
+				}
+			});
+
+			ResultSink = TotalDistance;
+		}
+	}
+
+	static TSharedRef<FJsonObject> ToJson(const TArray<FResult>& Results)
+	{
+		TArray<TSharedPtr<FJsonValue>> ResultValues;
+		for (const FResult& Result : Results)
+		{
+			TSharedRef<FJsonObject> ResultObject = MakeShared<FJsonObject>();
+			ResultObject->SetStringField(TEXT("Name"), Result.Name);
+			ResultObject->SetNumberField(TEXT("Size"), Result.Size);
+			ResultObject->SetNumberField(TEXT("Ops"), Result.NumOps);
+			ResultObject->SetNumberField(TEXT("NsPerOp"), Result.NsPerOp);
+			ResultObject->SetNumberField(TEXT("ItemsPerSecond"), Result.ItemsPerSecond);
+			ResultObject->SetNumberField(TEXT("AllocationsPerOp"), Result.AllocationsPerOp);
+			if (Result.MaxNsPerOp > 0.0)
+			{
+				ResultObject->SetNumberField(TEXT("P50NsPerOp"), Result.P50NsPerOp);
+				ResultObject->SetNumberField(TEXT("P95NsPerOp"), Result.P95NsPerOp);
+				ResultObject->SetNumberField(TEXT("MaxNsPerOp"), Result.MaxNsPerOp);
+			}
+			if (Result.LengthError >= 0.0)
+			{
+				ResultObject->SetNumberField(TEXT("LengthError"), Result.LengthError);
+			}
+			if (Result.RelaxLengthError >= 0.0)
+			{
+				ResultObject->SetNumberField(TEXT("RelaxLengthError"), Result.RelaxLengthError);
+			}
+			if (Result.RelaxNsPerOp >= 0.0)
+			{
+				ResultObject->SetNumberField(TEXT("RelaxNsPerOp"), Result.RelaxNsPerOp);
+			}
+			ResultValues.Add(MakeShared<FJsonValueObject>(ResultObject));
+		}
+
+		TSharedRef<FJsonObject> RootObject = MakeShared<FJsonObject>();
+		RootObject->SetStringField(TEXT("Date"), FDateTime::UtcNow().ToIso8601());
+		RootObject->SetArrayField(TEXT("Results"), ResultValues);
+		return RootObject;
+	}
+
+	static bool LoadBaseline(const FString& Path, TMap<FString, FResult>& OutBaseline)
+	{
+		FString JsonString;
+		if (!FFileHelper::LoadFileToString(JsonString, *Path))
+		{
+			return false;
+		}
+
+		TSharedPtr<FJsonObject> RootObject;
+		if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(JsonString), RootObject) || !RootObject.IsValid())
+		{
+			return false;
+		}
+
+		const TArray<TSharedPtr<FJsonValue>>* ResultValues = nullptr;
+		if (!RootObject->TryGetArrayField(TEXT("Results"), ResultValues))
+		{
+			return false;
+		}
+
+		for (const TSharedPtr<FJsonValue>& ResultValue : *ResultValues)
+		{
+			const TSharedPtr<FJsonObject>* ResultObject = nullptr;
+			if (!ResultValue->TryGetObject(ResultObject))
+			{
+				continue;
+			}
+
+			FResult Result;
+			Result.Name = (*ResultObject)->GetStringField(TEXT("Name"));
+			Result.Size = (int32)(*ResultObject)->GetNumberField(TEXT("Size"));
+			Result.NsPerOp = (*ResultObject)->GetNumberField(TEXT("NsPerOp"));
+			Result.AllocationsPerOp = (*ResultObject)->GetNumberField(TEXT("AllocationsPerOp"));
+			OutBaseline.Add(FString::Printf(TEXT("%s/%d"), *Result.Name, Result.Size), Result);
+		}
+
+		return true;
+	}
+
+	FReportOptions ParseReportOptions(const FString& Args, const TCHAR* DefaultFilePrefix)
+	{
+		FReportOptions Options;
+		Options.OutPath = FPaths::ProjectSavedDir() / TEXT("WibblyWires") / FString::Printf(TEXT("%s-%s.json"), DefaultFilePrefix, *FDateTime::Now().ToString());
+		FParse::Value(*Args, TEXT("Out="), Options.OutPath);
+		FParse::Value(*Args, TEXT("Baseline="), Options.BaselinePath);
+		FParse::Value(*Args, TEXT("Threshold="), Options.Threshold);
+		return Options;
+	}
+
+	int32 ReportResults(const TArray<FResult>& Results, const FReportOptions& Options, FOutputDevice& Ar)
+	{
+		for (const FResult& Result : Results)
+		{
+			if (Result.MaxNsPerOp > 0.0)
+			{
+				Ar.Logf(TEXT("%-40s %6d: %12.0f ns/op (p50 %.0f, p95 %.0f, max %.0f), %14.0f items/s, %6.1f allocs/op"), *Result.Name, Result.Size, Result.NsPerOp,
+					Result.P50NsPerOp, Result.P95NsPerOp, Result.MaxNsPerOp, Result.ItemsPerSecond, Result.AllocationsPerOp);
+			}
+			else if (Result.LengthError >= 0.0 && Result.RelaxLengthError > 0.0 && Result.RelaxNsPerOp > 0.0)
+			{
+				Ar.Logf(TEXT("%-40s %6d: %12.0f ns/op (%.2fx Relax), %14.0f items/s, %6.1f allocs/op, %.5f length error (%.2fx Relax)"), *Result.Name, Result.Size, Result.NsPerOp,
+					Result.NsPerOp / Result.RelaxNsPerOp, Result.ItemsPerSecond, Result.AllocationsPerOp, Result.LengthError, Result.LengthError / Result.RelaxLengthError);
+			}
+			else if (Result.LengthError >= 0.0)
+			{
+				Ar.Logf(TEXT("%-40s %6d: %12.0f ns/op, %14.0f items/s, %6.1f allocs/op, %.5f length error"), *Result.Name, Result.Size, Result.NsPerOp, Result.ItemsPerSecond, Result.AllocationsPerOp, Result.LengthError);
+			}
+			else
+			{
+				Ar.Logf(TEXT("%-40s %6d: %12.0f ns/op, %14.0f items/s, %6.1f allocs/op"), *Result.Name, Result.Size, Result.NsPerOp, Result.ItemsPerSecond, Result.AllocationsPerOp);
+			}
+		}
+
+		FString JsonString;
+		FJsonSerializer::Serialize(ToJson(Results), TJsonWriterFactory<>::Create(&JsonString));
+		if (FFileHelper::SaveStringToFile(JsonString, *Options.OutPath))
+		{
+			Ar.Logf(TEXT("WibblyWires: Wrote benchmark results to %s"), *Options.OutPath);
+		}
+		else
+		{
+			Ar.Logf(ELogVerbosity::Error, TEXT("WibblyWires: Couldn't write benchmark results to %s"), *Options.OutPath);
+		}
+
+		if (Options.BaselinePath.IsEmpty())
+		{
+			return 0;
+		}
+
+		TMap<FString, FResult> Baseline;
+		if (!LoadBaseline(Options.BaselinePath, Baseline))
+		{
+			Ar.Logf(ELogVerbosity::Error, TEXT("WibblyWires: Couldn't read benchmark baseline %s"), *Options.BaselinePath);
+			return 1;
+		}
+
+		int32 NumRegressions = 0;
+		for (const FResult& Result : Results)
+		{
+			const FResult* BaselineResult = Baseline.Find(FString::Printf(TEXT("%s/%d"), *Result.Name, Result.Size));
+			if (!BaselineResult || BaselineResult->NsPerOp <= 0.0)
+			{
+				continue;
+			}
+
+			const double Change = Result.NsPerOp / BaselineResult->NsPerOp - 1.0;
+			const bool bSlower = Change > Options.Threshold;
+			const bool bMoreAllocations = BaselineResult->AllocationsPerOp >= 0.0 && Result.AllocationsPerOp > BaselineResult->AllocationsPerOp;
+			if (bSlower || bMoreAllocations)
+			{
+				NumRegressions++;
+				Ar.Logf(ELogVerbosity::Warning, TEXT("REGRESSION %s %d: %+.1f%% time (%.0f -> %.0f ns/op), %.1f -> %.1f allocs/op"),
+					*Result.Name, Result.Size, Change * 100.0, BaselineResult->NsPerOp, Result.NsPerOp, BaselineResult->AllocationsPerOp, Result.AllocationsPerOp);
+			}
+		}
+
+		Ar.Logf(TEXT("WibblyWires: %d regressions against %s (threshold %.0f%%)"), NumRegressions, *Options.BaselinePath, Options.Threshold * 100.f);
+		return NumRegressions;
+	}
+
+	static int32 RunBenchmarks(const FString& Args)
+	{
+		LLM_SCOPE_BYTAG(WibblyWires);
+
+		const FReportOptions Options = ParseReportOptions(Args, TEXT("Benchmark"));
+
+		FRunner Runner;
+		FParse::Value(*Args, TEXT("Filter="), Runner.Filter);
+		RunAll(Runner);
+
+		return ReportResults(Runner.Results, Options, *GLog);
+	}
+}
+
+FAutoConsoleCommand CVarWibblyWiresBenchmark(
+	TEXT("WibblyWires.Benchmark"),
+	TEXT("Times the chain, spring and curve kernels across a range of sizes and writes the results as JSON.\n")
+	TEXT("Optional args: Out=<path> Baseline=<path> Threshold=<fraction, default 0.1> Filter=<substring of kernel name>"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		WibblyBenchmarks::RunBenchmarks(FString::Join(Args, TEXT(" ")));
+	})
+);
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// The same run as a test, so a regression against Baseline= fails it. Automation tests don't take args of their own, so
+// they're read from -WibblyWiresBenchmark="..." on the command line instead.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWibblyWiresBenchmarkTest, "WibblyWires.Perf.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FWibblyWiresBenchmarkTest::RunTest(const FString& Parameters)
+{
+	FString Args;
+	FParse::Value(FCommandLine::Get(), TEXT("WibblyWiresBenchmark="), Args, false);
+
+	const int32 NumRegressions = WibblyBenchmarks::RunBenchmarks(Args);
+	TestEqual(TEXT("Regressions against the baseline"), NumRegressions, 0);
+	return NumRegressions == 0;
+}
+
+#endif
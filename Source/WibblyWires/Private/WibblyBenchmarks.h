@@ -0,0 +1,248 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTLS.h"
+#include "Runtime/Launch/Resources/Version.h"
+
+#include <atomic>
+
+// Shared plumbing for the WibblyWires.Benchmark and WibblyWires.Stress commands
+namespace WibblyBenchmarks
+{
+	// Sits in front of GMalloc, counting allocations made on whichever thread has counting enabled.
+	// It's installed the first time a counter is needed and never removed, since anything allocated while it was in
+	// place might still be freed through it long after the benchmark has finished. So that stat memory, memreport and
+	// heap validation keep working for the rest of the session, every FMalloc virtual is passed on to the real allocator.
+	class FCountingMalloc : public FMalloc
+	{
+	public:
+		FCountingMalloc(FMalloc* InInnerMalloc)
+			: InnerMalloc(InInnerMalloc)
+		{
+		}
+
+		// Returns the proxy installed in front of GMalloc, installing it on first use
+		static FCountingMalloc& Get();
+
+		virtual void* Malloc(SIZE_T Size, uint32 Alignment) override
+		{
+			CountAllocation();
+			return InnerMalloc->Malloc(Size, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Size, uint32 Alignment) override
+		{
+			CountAllocation();
+			return InnerMalloc->TryMalloc(Size, Alignment);
+		}
+
+#if ENGINE_MAJOR_VERSION >= 5 && ENGINE_MINOR_VERSION >= 1
+		virtual void* MallocZeroed(SIZE_T Size, uint32 Alignment) override
+		{
+			CountAllocation();
+			return InnerMalloc->MallocZeroed(Size, Alignment);
+		}
+
+		virtual void* TryMallocZeroed(SIZE_T Size, uint32 Alignment) override
+		{
+			CountAllocation();
+			return InnerMalloc->TryMallocZeroed(Size, Alignment);
+		}
+#endif
+
+		virtual void* Realloc(void* Original, SIZE_T Size, uint32 Alignment) override
+		{
+			if (Size > 0)
+			{
+				CountAllocation();
+			}
+			return InnerMalloc->Realloc(Original, Size, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Size, uint32 Alignment) override
+		{
+			if (Size > 0)
+			{
+				CountAllocation();
+			}
+			return InnerMalloc->TryRealloc(Original, Size, Alignment);
+		}
+
+		virtual void Free(void* Original) override
+		{
+			InnerMalloc->Free(Original);
+		}
+
+		virtual SIZE_T QuantizeSize(SIZE_T Size, uint32 Alignment) override
+		{
+			return InnerMalloc->QuantizeSize(Size, Alignment);
+		}
+
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+		{
+			return InnerMalloc->GetAllocationSize(Original, SizeOut);
+		}
+
+		virtual void Trim(bool bTrimThreadCaches) override
+		{
+			InnerMalloc->Trim(bTrimThreadCaches);
+		}
+
+		virtual void SetupTLSCachesOnCurrentThread() override
+		{
+			InnerMalloc->SetupTLSCachesOnCurrentThread();
+		}
+
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+		{
+			InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread();
+		}
+
+		virtual void InitializeStatsMetadata() override
+		{
+			InnerMalloc->InitializeStatsMetadata();
+		}
+
+		virtual void UpdateStats() override
+		{
+			InnerMalloc->UpdateStats();
+		}
+
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override
+		{
+			InnerMalloc->GetAllocatorStats(OutStats);
+		}
+
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override
+		{
+			InnerMalloc->DumpAllocatorStats(Ar);
+		}
+
+		virtual bool IsInternallyThreadSafe() const override
+		{
+			return InnerMalloc->IsInternallyThreadSafe();
+		}
+
+		virtual bool ValidateHeap() override
+		{
+			return InnerMalloc->ValidateHeap();
+		}
+
+		virtual const TCHAR* GetDescriptiveName() override
+		{
+			return InnerMalloc->GetDescriptiveName();
+		}
+
+		virtual void OnMallocInitialized() override
+		{
+			InnerMalloc->OnMallocInitialized();
+		}
+
+		virtual void OnPreFork() override
+		{
+			InnerMalloc->OnPreFork();
+		}
+
+		virtual void OnPostFork() override
+		{
+			InnerMalloc->OnPostFork();
+		}
+
+		// Starts counting allocations made on the calling thread, returning false if another thread is already counting
+		bool BeginCounting()
+		{
+			uint32 Expected = 0;
+			if (!CountingThreadId.compare_exchange_strong(Expected, FPlatformTLS::GetCurrentThreadId()))
+			{
+				return false;
+			}
+			ResetCount();
+			return true;
+		}
+
+		void ResetCount()
+		{
+			NumAllocations.store(0, std::memory_order_relaxed);
+		}
+
+		void EndCounting()
+		{
+			CountingThreadId.store(0);
+		}
+
+		uint64 GetNumAllocations() const
+		{
+			return NumAllocations.load(std::memory_order_relaxed);
+		}
+
+	private:
+		void CountAllocation()
+		{
+			// Thread ids are never 0, so this is a single cheap load whenever nothing is being counted
+			const uint32 ThreadId = CountingThreadId.load(std::memory_order_relaxed);
+			if (ThreadId != 0 && ThreadId == FPlatformTLS::GetCurrentThreadId())
+			{
+				NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		FMalloc* InnerMalloc;
+		std::atomic<uint32> CountingThreadId{0};
+		std::atomic<uint64> NumAllocations{0};
+	};
+
+	// Counts allocations made on the calling thread for the lifetime of the scope.
+	// Some platforms call a fixed allocator class without going through GMalloc, in which case counting isn't available.
+	struct FScopedAllocationCounter
+	{
+		FScopedAllocationCounter();
+		~FScopedAllocationCounter();
+
+		// Negative if we can't tell
+		double GetNumAllocations() const
+		{
+			return bIsCounting ? (double)FCountingMalloc::Get().GetNumAllocations() : -1.0;
+		}
+
+	private:
+		bool bIsCounting = false;
+	};
+
+	struct FResult
+	{
+		FString Name;
+		int32 Size = 0;
+		int32 NumOps = 0;
+		double NsPerOp = 0.0;
+		double ItemsPerSecond = 0.0;
+		double AllocationsPerOp = 0.0;
+
+		// Distribution of individual ops, for runs that time each op on its own
+		double P50NsPerOp = 0.0;
+		double P95NsPerOp = 0.0;
+		double MaxNsPerOp = 0.0;
+
+		// Mean relative stick length error once a chain kernel has finished running, negative where it doesn't apply
+		double LengthError = -1.0;
+		// The same chain's LengthError and NsPerOp under the default Relax solver, so the other solvers can be read against it
+		double RelaxLengthError = -1.0;
+		double RelaxNsPerOp = -1.0;
+	};
+
+	// Where to write results, and what to compare them against
+	struct FReportOptions
+	{
+		FString OutPath;
+		FString BaselinePath;
+		float Threshold = 0.1f;
+	};
+
+	// Picks up Out=, Baseline= and Threshold= from a command's args, defaulting to a timestamped file in Saved/WibblyWires
+	FReportOptions ParseReportOptions(const FString& Args, const TCHAR* DefaultFilePrefix);
+
+	// Prints and writes out Results as JSON, then flags anything that got slower than Threshold or allocates more than the baseline.
+	// Returns how many regressions were found, counting a baseline that couldn't be read as one.
+	int32 ReportResults(const TArray<FResult>& Results, const FReportOptions& Options, FOutputDevice& Ar);
+}
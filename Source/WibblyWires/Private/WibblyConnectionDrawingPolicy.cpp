@@ -5,10 +5,35 @@
 
 #include "EdGraphSchema_K2.h"
 #include "Verlet.h"
-#include "Engine/SpringInterpolator.h"
+#include "WibblySimulation.h"
+#include "WibblyWiresStats.h"
+#include "WireCurve.h"
+#include "Async/ParallelFor.h"
+#include "Rendering/SlateRenderer.h"
+#include "Widgets/SWindow.h"
+
+// Re-use these between graphs and frames to save on allocations
+static TArray<float> BubbleDistances;
+static TArray<float> BubbleAlphas;
+static TArray<FVectorType> BubblePositions;
+static TArray<FSlateVertex> BubbleVertices;
+static TArray<SlateIndex> BubbleIndices;
+
+// Either pin is null for the free end of a preview connector
+static FWireId MakeWireId(const UEdGraphPin* StartPin, const UEdGraphPin* EndPin)
+{
+	return FWireId(StartPin ? StartPin->PinId : FGuid(), EndPin ? EndPin->PinId : FGuid());
+}
 
-// For each graph guid, store a map from wire id to wire state
-static TMap<FGuid, FGraphState> GraphStates;
+// Active timers keeping each window repainting while it has wires in motion.
+// Each timer's state is owned by its delegate, so it goes away with the timer (or the window it's registered on), and
+// this list only holds weak references for finding them again.
+struct FRepaintTimer
+{
+	TWeakPtr<SWindow> Window;
+	uint64 LastMovingFrame = 0;
+};
+static TArray<TWeakPtr<FRepaintTimer>> RepaintTimers;
 
 static int32 EnableWibblyWires = 1;
 FAutoConsoleVariableRef CVarEnableWibblyWires(
@@ -22,39 +47,39 @@ FAutoConsoleVariableRef CVarThicknessMultiplier(
 	ThicknessMultiplier,
 	TEXT("How much thicker to draw the wire lines."));
 
-static int32 BounceWires = 0;
-FAutoConsoleVariableRef CVarBounceWires(
-	TEXT("WibblyWires.BounceWires"),
-	BounceWires,
-	TEXT("Whether wires have some bounce when they extend too far")
+static int32 ParallelPrepareWires = 1;
+FAutoConsoleVariableRef CVarParallelPrepareWires(
+	TEXT("WibblyWires.ParallelPrepare"),
+	ParallelPrepareWires,
+	TEXT("Whether per-wire culling, curves and hover bounds tests should be spread across task graph workers on large graphs")
 );
 
-static float RopeLengthHangMultiplier = 1.f;
-FAutoConsoleVariableRef CVarWireLength(
-	TEXT("WibblyWires.WireLength"),
-	RopeLengthHangMultiplier,
-	TEXT("How much extra length should wires have")
+static int32 ParallelPrepareMinWires = 512;
+FAutoConsoleVariableRef CVarParallelPrepareMinWires(
+	TEXT("WibblyWires.ParallelPrepareMinWires"),
+	ParallelPrepareMinWires,
+	TEXT("How many wires a graph needs before preparing them in parallel is worth the overhead")
 );
 
-float WireShrinkRate = 150.f;
-FAutoConsoleVariableRef CVarWireShrinkRate(
-	TEXT("WibblyWires.WireShrinkRate"),
-	WireShrinkRate,
-	TEXT("How quickly should wires get sucked back into their nodes after having been cut")
+static int32 ParallelPrepareChunkSize = 128;
+FAutoConsoleVariableRef CVarParallelPrepareChunkSize(
+	TEXT("WibblyWires.ParallelPrepareChunkSize"),
+	ParallelPrepareChunkSize,
+	TEXT("How many wires each parallel task prepares")
 );
 
-float SecondsBeforeBreaking = 1.f;
-FAutoConsoleVariableRef CVarSecondsBeforeBreaking(
-	TEXT("WibblyWires.SecondsBeforeBreaking"),
-	SecondsBeforeBreaking,
-	TEXT("How many seconds should cut wires dangle before detaching from their nodes and falling")
+static float WireCullMargin = 100.f;
+FAutoConsoleVariableRef CVarWireCullMargin(
+	TEXT("WibblyWires.CullMargin"),
+	WireCullMargin,
+	TEXT("How far (in pixels) outside the visible area a wire's last known bounds can be before it's skipped entirely")
 );
 
-float WireFriction = 0.9996f;
-FAutoConsoleVariableRef CVarWireFriction(
-	TEXT("WibblyWires.WireFriction"),
-	WireFriction,
-	TEXT("Friction multiplier for velocities, should be very close to 1.")
+static float WireTessellationSegmentLength = 12.f;
+FAutoConsoleVariableRef CVarWireTessellationSegmentLength(
+	TEXT("WibblyWires.TessellationSegmentLength"),
+	WireTessellationSegmentLength,
+	TEXT("Roughly how long (in pixels) each line segment of a tessellated wire should be")
 );
 
 FAutoConsoleCommand CVarResetWireStates(
@@ -62,193 +87,462 @@ FAutoConsoleCommand CVarResetWireStates(
 	TEXT("Resets wire states so that they're reinitialized with latest defaults etc."),
 	FConsoleCommandDelegate::CreateLambda([]()
 	{
-		GraphStates.Reset();
+		FWibblySimulation::Get().Reset();
 	})
 );
 
-FWireState::FWireState(FVector2D StartPoint, FVector2D EndPoint, float SpringStiffness, float SpringDampeningRatio, float InDesiredSlackMultiplier)
+void FWireDrawCache::Tessellate(const FWireCurve& Curve)
 {
-	LastStartPoint = StartPoint;
-	LastEndPoint = EndPoint;
-	DesiredSlackMultiplier = InDesiredSlackMultiplier;
-
-	// Snap to the desired rope length
-	DesiredRopeLength = CalculateDesiredRopeLength(StartPoint, EndPoint);
-	LerpedRopeLength = DesiredRopeLength * 1.1f; // Start off a little off from desired so there's an initial bounce
-
-	// Snap to the desired center point
-	float LengthDelta = LerpedRopeLength - (EndPoint - StartPoint).Size();
-	DesiredRopeCenterPoint = CalculateDesiredCenterPointWithRopeLengthDelta(StartPoint, EndPoint, LengthDelta);
-	SpringCenterPoint.SetSpringConstants(SpringStiffness, SpringDampeningRatio);
-	SpringCenterPoint.Reset(FVector(DesiredRopeCenterPoint, 0.f));
+	// Control polygon length is a cheap upper bound on the arc length
+	const FVectorType P0 = Curve.Eval(0.f);
+	const FVectorType P1 = Curve.Eval(1.f);
+	const FVectorType Control0 = P0 + Curve.C / 3.f;
+	const FVectorType Control1 = P1 - (3.f * Curve.A + 2.f * Curve.B + Curve.C) / 3.f;
+	const float ControlLength = (Control0 - P0).Size() + (Control1 - Control0).Size() + (P1 - Control1).Size();
+	const int32 NumSegments = FMath::Clamp(FMath::CeilToInt(ControlLength / FMath::Max(WireTessellationSegmentLength, 1.f)), 4, 64);
+
+	CachedPoints.SetNumUninitialized(NumSegments + 1);
+	const float Step = 1.f / NumSegments;
+	for (int32 i = 0; i <= NumSegments; i++)
+	{
+		CachedPoints[i] = Curve.Eval(i * Step);
+	}
+
+	// Built again on demand, only for wires that need them
+	CachedArcLengths.Reset();
 }
 
-FVector2D FWireState::CalculateDesiredCenterPointWithRopeLengthDelta(FVector2D StartPoint, FVector2D EndPoint, float RopeLengthDelta)
+void FWireDrawCache::BuildArcLengths()
 {
-	FVector2D Center = CalculateDesiredCenterPoint(StartPoint, EndPoint);
-	Center.Y += RopeLengthDelta * RopeLengthHangMultiplier;
-	return Center;
+	CachedArcLengths.SetNumUninitialized(CachedPoints.Num());
+
+	float Length = 0.f;
+	for (int32 i = 0; i < CachedPoints.Num(); i++)
+	{
+		Length += i > 0 ? (CachedPoints[i] - CachedPoints[i - 1]).Size() : 0.f;
+		CachedArcLengths[i] = Length;
+	}
 }
 
-FVector2D FWireState::CalculateDesiredCenterPoint(FVector2D StartPoint, FVector2D EndPoint)
+FConnectionDrawingPolicy* FWibblyConnectionDrawingPolicy::Factory::CreateConnectionPolicy(const UEdGraphSchema* Schema, int32 InBackLayerID, int32 InFrontLayerID, float InZoomFactor, const FSlateRect& InClippingRect, FSlateWindowElementList& InDrawElements, UEdGraph* InGraphObj) const
 {
-	if (StartPoint.X > EndPoint.X)
+	LLM_SCOPE_BYTAG(WibblyWires);
+	WIBBLY_SCOPE(STAT_WibblyWires_CreatePolicy);
+
+	if (EnableWibblyWires)
 	{
-		Swap(StartPoint, EndPoint);
+		if (Schema->IsA(UEdGraphSchema_K2::StaticClass()))
+		{
+			return new FWibblyConnectionDrawingPolicy(InBackLayerID, InFrontLayerID, InZoomFactor, InClippingRect, InDrawElements, InGraphObj);
+		}
+	}
+	else
+	{
+		// Release our memory if not even enabled
+		FWibblySimulation::Get().Reset();
 	}
 
-	FVector2D Delta = EndPoint - StartPoint;
-	FVector2D Direction = Delta.GetSafeNormal();
-	FVector2D UpDirection(0.f, 1.f);
-	float DotWithUp = Direction | UpDirection;
-	DotWithUp = FMath::Pow(FMath::Abs(DotWithUp), 2.f) * FMath::Sign(DotWithUp);
-	float NormalizedDotWithUp = DotWithUp * 0.5f + 0.5f;
-	float CenterX = FMath::Lerp(StartPoint.X, EndPoint.X, NormalizedDotWithUp);
-	// This won't be quite the same as deriving a CenterY from the real CenterX, but we'll see how it looks cause avoids some trig
-	FVector2D Center = FMath::Lerp(StartPoint, EndPoint, NormalizedDotWithUp);
-	return Center;
+	return nullptr;
 }
 
-float FWireState::CalculateDesiredRopeLength(FVector2D StartPoint, FVector2D EndPoint)
+FWibblyConnectionDrawingPolicy::FWibblyConnectionDrawingPolicy(int32 InBackLayerID, int32 InFrontLayerID, float InZoomFactor, const FSlateRect& InClippingRect, FSlateWindowElementList& InDrawElements, UEdGraph* InGraphObj)
+	: FKismetConnectionDrawingPolicy(InBackLayerID, InFrontLayerID, InZoomFactor, InClippingRect, InDrawElements, InGraphObj)
+	, GraphObj(InGraphObj)
+	, GraphDrawState(FWibblySimulation::Get().FindOrAddGraphDrawState(InGraphObj->GraphGuid))
+	, GraphSnapshot(FWibblySimulation::Get().FindGraphSnapshot(InGraphObj->GraphGuid))
 {
-	FVector2D Delta = EndPoint - StartPoint;
-	float TightRopeLength = Delta.Size();
-	return TightRopeLength * DesiredSlackMultiplier;
+	if (GraphDrawState.GraphName.IsEmpty())
+	{
+		GraphDrawState.GraphName = InGraphObj->GetPathName();
+	}
 }
 
-FVector2D FWireState::Update(FVector2D StartPoint, FVector2D EndPoint, float DeltaTime)
+FWibblyConnectionDrawingPolicy::~FWibblyConnectionDrawingPolicy()
 {
-	LastStartPoint = StartPoint;
-	LastEndPoint = EndPoint;
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	// Preview connectors are drawn outside of Draw, so catch anything they queued up
+	FlushBubbles();
+
+	// We're done painting, so we know whether anything still needs animating
+	KeepRepaintingWhileMoving();
+}
+
+void FWibblyConnectionDrawingPolicy::Draw(TMap<TSharedRef<SWidget>, FArrangedWidget>& InPinGeometries, FArrangedChildren& ArrangedNodes)
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	FKismetConnectionDrawingPolicy::Draw(InPinGeometries, ArrangedNodes);
+
+	FlushBubbles();
+}
+
+void FWibblyConnectionDrawingPolicy::KeepRepaintingWhileMoving()
+{
+	SWindow* PaintWindow = DrawElementsList.GetPaintWindow();
+	if (!PaintWindow)
+	{
+		return;
+	}
+
+	if (IsGraphAtRest())
+	{
+		return;
+	}
+
+	// Timers that have stopped, or whose window has been destroyed, have already let go of their state
+	RepaintTimers.RemoveAllSwap([](const TWeakPtr<FRepaintTimer>& Timer) { return !Timer.IsValid(); });
+
+	for (const TWeakPtr<FRepaintTimer>& WeakTimer : RepaintTimers)
+	{
+		const TSharedPtr<FRepaintTimer> Timer = WeakTimer.Pin();
+		if (Timer && Timer->Window.Pin().Get() == PaintWindow)
+		{
+			Timer->LastMovingFrame = GFrameCounter;
+			return;
+		}
+	}
+
+	// The timer stops itself once a frame goes by with nothing moving, after which Slate is free to go idle
+	const TSharedRef<SWindow> Window = StaticCastSharedRef<SWindow>(PaintWindow->AsShared());
+	const TSharedRef<FRepaintTimer> Timer = MakeShared<FRepaintTimer>();
+	Timer->Window = Window;
+	Timer->LastMovingFrame = GFrameCounter;
+	RepaintTimers.Add(Timer);
+
+	Window->RegisterActiveTimer(0.f, FWidgetActiveTimerDelegate::CreateLambda([Timer](double InCurrentTime, float InDeltaTime)
+	{
+		const TSharedPtr<SWindow> PinnedWindow = Timer->Window.Pin();
+		if (PinnedWindow && GFrameCounter - Timer->LastMovingFrame <= 1)
+		{
+			PinnedWindow->Invalidate(EInvalidateWidgetReason::Paint);
+			return EActiveTimerReturnType::Continue;
+		}
+
+		return EActiveTimerReturnType::Stop;
+	}));
+}
+
+void FWibblyConnectionDrawingPolicy::AddBubbles(int32 LayerId, TArrayView<const FVectorType> Positions, const FVectorType& BubbleSize, const FLinearColor& Color)
+{
+	if (Positions.Num() == 0)
+	{
+		return;
+	}
 
-	// Ensure start point is always the left-most point so we can make some assumptions with our math
-	if (StartPoint.X > EndPoint.X)
+	// Everything in a batch has to share a layer
+	if (BubbleLayerId != LayerId)
 	{
-		Swap(StartPoint, EndPoint);
+		FlushBubbles();
+		BubbleLayerId = LayerId;
 	}
 
-	FVector2D Delta = EndPoint - StartPoint;
+	if (!BubbleResourceHandle.IsValid())
+	{
+		BubbleResourceHandle = FSlateApplication::Get().GetRenderer()->GetResourceHandle(*BubbleImage);
+	}
 
-	float TightRopeLength = Delta.Size();
+	// The bubble brush may live in an atlas, so map our quad UVs into its sub-region
+	FVectorType UVMin(0.f, 0.f);
+	FVectorType UVMax(1.f, 1.f);
+	if (const FSlateShaderResourceProxy* ResourceProxy = BubbleResourceHandle.GetResourceProxy())
+	{
+		UVMin = FVectorType(ResourceProxy->StartUV);
+		UVMax = UVMin + FVectorType(ResourceProxy->SizeUV);
+	}
 
-	DesiredRopeLength = TightRopeLength * DesiredSlackMultiplier;
-	LerpedRopeLength = FMath::Max(TightRopeLength, FMath::Lerp(LerpedRopeLength, DesiredRopeLength, DeltaTime * 20.f));
-	float LengthDelta = LerpedRopeLength - TightRopeLength;
+	const FSlateRenderTransform Identity;
+	const FColor VertexColor = Color.ToFColor(false);
+	const FVectorType HalfSize = BubbleSize * 0.5f;
 
-	DesiredRopeCenterPoint = CalculateDesiredCenterPointWithRopeLengthDelta(StartPoint, EndPoint, LengthDelta);
+	BubbleVertices.Reserve(BubbleVertices.Num() + Positions.Num() * 4);
+	BubbleIndices.Reserve(BubbleIndices.Num() + Positions.Num() * 6);
 
-	// Calculate desired center point
-	FVector2D LerpedCenterPoint = FVector2D(SpringCenterPoint.Update(FVector(DesiredRopeCenterPoint, 0.f), DeltaTime));
+	for (const FVectorType& Position : Positions)
+	{
+		const FVectorType Min = Position - HalfSize;
+		const FVectorType Max = Position + HalfSize;
+		const SlateIndex FirstIndex = (SlateIndex)BubbleVertices.Num();
+
+		BubbleVertices.Add(FSlateVertex::Make<ESlateVertexRounding::Disabled>(Identity, Min, UVMin, VertexColor));
+		BubbleVertices.Add(FSlateVertex::Make<ESlateVertexRounding::Disabled>(Identity, FVectorType(Max.X, Min.Y), FVectorType(UVMax.X, UVMin.Y), VertexColor));
+		BubbleVertices.Add(FSlateVertex::Make<ESlateVertexRounding::Disabled>(Identity, FVectorType(Min.X, Max.Y), FVectorType(UVMin.X, UVMax.Y), VertexColor));
+		BubbleVertices.Add(FSlateVertex::Make<ESlateVertexRounding::Disabled>(Identity, Max, UVMax, VertexColor));
+
+		BubbleIndices.Add(FirstIndex + 0);
+		BubbleIndices.Add(FirstIndex + 1);
+		BubbleIndices.Add(FirstIndex + 2);
+		BubbleIndices.Add(FirstIndex + 2);
+		BubbleIndices.Add(FirstIndex + 1);
+		BubbleIndices.Add(FirstIndex + 3);
+	}
+}
 
-	FVector2D Velocity = FVector2D(SpringCenterPoint.GetVelocity());
-	if (BounceWires && LerpedCenterPoint.Y > DesiredRopeCenterPoint.Y && Velocity.Y > 0.1f)
+void FWibblyConnectionDrawingPolicy::FlushBubbles()
+{
+	if (BubbleVertices.Num() > 0 && BubbleResourceHandle.IsValid())
 	{
-		Velocity.Y = FMath::Abs(Velocity.Y) * -0.9f;
-		SpringCenterPoint.SetVelocity(FVector(Velocity, 0.f));
+		FSlateDrawElement::MakeCustomVerts(DrawElementsList, BubbleLayerId, BubbleResourceHandle, BubbleVertices, BubbleIndices, nullptr, 0, 0);
 	}
 
-	return LerpedCenterPoint;
+	BubbleVertices.Reset();
+	BubbleIndices.Reset();
+	BubbleLayerId = INDEX_NONE;
 }
 
-FConnectionDrawingPolicy* FWibblyConnectionDrawingPolicy::Factory::CreateConnectionPolicy(const UEdGraphSchema* Schema, int32 InBackLayerID, int32 InFrontLayerID, float InZoomFactor, const FSlateRect& InClippingRect, FSlateWindowElementList& InDrawElements, UEdGraph* InGraphObj) const
+void FWibblyConnectionDrawingPolicy::DrawPinGeometries(TMap<TSharedRef<SWidget>, FArrangedWidget>& InPinGeometries, FArrangedChildren& ArrangedNodes)
 {
-	if (EnableWibblyWires)
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	// Let the base pin iteration funnel every connection through DrawConnection, which just records them,
+	// then process the whole graph's worth of wires together
+	const double CurrentTime = FPlatformTime::Seconds();
+	GraphDrawState.DrawPass++;
+	bGraphWasHidden = CurrentTime - GraphDrawState.LastDrawnTime > WireCatchUpThreshold;
+	GraphDrawState.LastDrawnTime = CurrentTime;
+	bGatheringWires = true;
+	FKismetConnectionDrawingPolicy::DrawPinGeometries(InPinGeometries, ArrangedNodes);
+	bGatheringWires = false;
+
+	const int32 NumDrawnWires = PendingWires.Num();
+	DrawPendingWires();
+	PruneDrawCaches(NumDrawnWires);
+}
+
+void FWibblyConnectionDrawingPolicy::PruneDrawCaches(int32 NumDrawnWires)
+{
+	// Every wire in the graph goes through a full draw (culled ones included), so there's nothing to prune unless there are more caches than that
+	if (GraphDrawState.Wires.Num() <= NumDrawnWires)
 	{
-		if (Schema->IsA(UEdGraphSchema_K2::StaticClass()))
+		return;
+	}
+
+	// Preview connectors are drawn after the main pass, so give everything one pass of grace
+	const uint32 DrawPass = GraphDrawState.DrawPass;
+	for (auto It = GraphDrawState.Wires.CreateIterator(); It; ++It)
+	{
+		if (DrawPass - It.Value().LastDrawPass > 1)
 		{
-			return new FWibblyConnectionDrawingPolicy(InBackLayerID, InFrontLayerID, InZoomFactor, InClippingRect, InDrawElements, InGraphObj);
+			It.RemoveCurrent();
 		}
 	}
-	else
+}
+
+void FWibblyConnectionDrawingPolicy::DrawConnection(int32 LayerId, const FVector2D& Start, const FVector2D& End, const FConnectionParams& Params)
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	FPendingWire& PendingWire = PendingWires.AddDefaulted_GetRef();
+	PendingWire.LayerId = LayerId;
+	PendingWire.Start = FVectorType(Start);
+	PendingWire.End = FVectorType(End);
+	PendingWire.Params = Params;
+
+	// Anything drawn outside of the main pass (e.g. preview connectors) goes through as a batch of one
+	if (!bGatheringWires)
 	{
-		// Release our memory if not even enabled
-		GraphStates.Empty();
+		DrawPendingWires();
 	}
-
-	return nullptr;
 }
 
-namespace FRK4SpringInterpolatorUtils
+void FWibblyConnectionDrawingPolicy::DrawPendingWires()
 {
-	static FORCEINLINE bool IsValidValue(FVector2D Value, float MaxAbsoluteValue = RK4_SPRING_INTERPOLATOR_MAX_VALUE)
+	if (PendingWires.Num() == 0)
 	{
-		return Value.GetAbsMax() < MaxAbsoluteValue;
+		return;
 	}
 
-#if ENGINE_MAJOR_VERSION >= 5 && ENGINE_MINOR_VERSION >= 1
-	static FORCEINLINE bool AreEqual(FVector2D A, FVector2D B, float ErrorTolerance = UE_KINDA_SMALL_NUMBER)
+	WIBBLY_SCOPE(STAT_WibblyWires_DrawConnections);
+	const double DrawStartTime = FPlatformTime::Seconds();
+
+	ResolveDrawCaches();
+
+	const float ThicknessScale = ThicknessMultiplier * FSlateApplication::Get().GetApplicationScale() * ZoomFactor;
+
+	// Each wire only touches its own cache here, so this is safe to split up. Emitting to Slate has to stay on this thread.
+	const int32 NumWires = PendingWires.Num();
+	if (ParallelPrepareWires && NumWires >= ParallelPrepareMinWires)
 	{
-		return A.Equals(B, ErrorTolerance);
+		WIBBLY_SCOPE(STAT_WibblyWires_PrepareWires);
+		const int32 ChunkSize = FMath::Max(ParallelPrepareChunkSize, 1);
+		const int32 NumChunks = FMath::DivideAndRoundUp(NumWires, ChunkSize);
+		ParallelFor(NumChunks, [this, ChunkSize, NumWires, ThicknessScale](int32 ChunkIndex)
+		{
+			// Tessellating can grow a wire's cached points, and worker threads don't inherit our tag
+			LLM_SCOPE_BYTAG(WibblyWires);
+
+			const int32 First = ChunkIndex * ChunkSize;
+			const int32 Last = FMath::Min(First + ChunkSize, NumWires);
+			for (int32 i = First; i < Last; i++)
+			{
+				PrepareWire(PendingWires[i], ThicknessScale);
+			}
+		});
 	}
-#else
-	static FORCEINLINE bool AreEqual(FVector2D A, FVector2D B, float ErrorTolerance = KINDA_SMALL_NUMBER)
+	else
 	{
-		return A.Equals(B, ErrorTolerance);
+		WIBBLY_SCOPE(STAT_WibblyWires_PrepareWires);
+		for (FPendingWire& PendingWire : PendingWires)
+		{
+			PrepareWire(PendingWire, ThicknessScale);
+		}
 	}
-#endif
 
+	// Keep the closest of the wires near the mouse
+	ResolveHover();
+
+	SubmitSimulationInputs();
+
+	{
+		WIBBLY_SCOPE(STAT_WibblyWires_EmitWires);
+
+		int32 NumDrawn = 0;
+		int32 NumTessellated = 0;
+		for (const FPendingWire& PendingWire : PendingWires)
+		{
+			if (!PendingWire.bIsCulled)
+			{
+				EmitWire(PendingWire);
+				NumDrawn++;
+				NumTessellated += PendingWire.bIsDirty ? 1 : 0;
+			}
+		}
+
+		INC_DWORD_STAT_BY(STAT_WibblyWires_WiresDrawn, NumDrawn);
+		INC_DWORD_STAT_BY(STAT_WibblyWires_WiresCulled, PendingWires.Num() - NumDrawn);
+		INC_DWORD_STAT_BY(STAT_WibblyWires_WiresTessellated, NumTessellated);
+	}
+
+	// Bubbles all go out as one batch at the end anyway, so they can be done in a pass of their own
+	{
+		WIBBLY_SCOPE(STAT_WibblyWires_DrawBubbles);
+
+		for (const FPendingWire& PendingWire : PendingWires)
+		{
+			if (!PendingWire.bIsCulled && PendingWire.Params.bDrawBubbles)
+			{
+				EmitBubbles(PendingWire);
+			}
+		}
+	}
+
+	PendingWires.Reset();
+
+	GraphDrawState.DrawTimes.AddSample(FPlatformTime::Seconds() - DrawStartTime);
 }
 
-FWibblyConnectionDrawingPolicy::FWibblyConnectionDrawingPolicy(int32 InBackLayerID, int32 InFrontLayerID, float InZoomFactor, const FSlateRect& InClippingRect, FSlateWindowElementList& InDrawElements, UEdGraph* InGraphObj)
-	: FKismetConnectionDrawingPolicy(InBackLayerID, InFrontLayerID, InZoomFactor, InClippingRect, InDrawElements, InGraphObj)
-	, GraphObj(InGraphObj)
-	, GraphState(GraphStates.FindOrAdd(InGraphObj->GraphGuid))
+void FWibblyConnectionDrawingPolicy::ResolveDrawCaches()
 {
+	// Add any new wires first, since adding to the map can move existing caches around
+	for (const FPendingWire& PendingWire : PendingWires)
+	{
+		GraphDrawState.Wires.FindOrAdd(MakeWireId(PendingWire.Params.AssociatedPin1, PendingWire.Params.AssociatedPin2));
+	}
+
+	// Now the map is stable we can hang on to pointers into it
+	for (FPendingWire& PendingWire : PendingWires)
+	{
+		const FWireId WireId = MakeWireId(PendingWire.Params.AssociatedPin1, PendingWire.Params.AssociatedPin2);
+		PendingWire.DrawCache = GraphDrawState.Wires.Find(WireId);
+		PendingWire.DrawCache->LastDrawPass = GraphDrawState.DrawPass;
+
+		const FVectorType* SimulatedCenterPoint = GraphSnapshot ? GraphSnapshot->CenterPoints.Find(WireId) : nullptr;
+		if (SimulatedCenterPoint)
+		{
+			PendingWire.CenterPoint = *SimulatedCenterPoint;
+		}
+		else
+		{
+			// The simulation hasn't seen this wire yet, so hang it exactly where it'll start off
+			PendingWire.CenterPoint = FWireState(PendingWire.Start, PendingWire.End, FWireParams::FromHash(GetTypeHash(WireId), WireId.IsPreviewConnector())).CenterPoint;
+		}
+	}
 }
 
-void FWibblyConnectionDrawingPolicy::DrawConnection(int32 LayerId, const FVector2D& Start, const FVector2D& End, const FConnectionParams& Params)
+bool FWibblyConnectionDrawingPolicy::IsGraphAtRest() const
 {
-	const FVector2D& P0 = Start;
-	const FVector2D& P1 = End;
-
-	const float DefaultStiffness = 100.f;
-    const float DefaultDampeningRatio = 0.4f;
-
-	float WireThickness = Params.WireThickness * ThicknessMultiplier * FSlateApplication::Get().GetApplicationScale() * ZoomFactor;
-
-    const FWireId WireId(Params.AssociatedPin1, Params.AssociatedPin2);
-    FWireState* WireState = GraphState.Wires.Find(WireId);
-
-	// Create a new wire if needed
-    if (!WireState)
-    {
-    	bool bIsPreviewConnector = Params.AssociatedPin1 == nullptr || Params.AssociatedPin2 == nullptr;
-    	float StiffnessVariance = FMath::FRandRange(0.3f, 1.5f);
-    	float DampeningVariance = FMath::FRandRange(0.7f, 1.2f);
-    	float SlackMultiplier = 1.3f + FMath::FRandRange(0.f, 0.3f);
-    	float Stiffness = DefaultStiffness * StiffnessVariance + (bIsPreviewConnector ? 0.3f : 0.f);
-    	float DampeningRatio = FMath::Clamp(DefaultDampeningRatio * DampeningVariance, 0.3f, 0.9f);
-    	FWireState NewWireState(Start, End, Stiffness, DampeningRatio, SlackMultiplier);
-    	NewWireState.Color = Params.WireColor;
-
-    	for (const auto& ExistingState : GraphState.Wires)
-    	{
-    		if (!ExistingState.Key.IsPreviewConnector())
-    		{
-    			continue;
-    		}
-
-    		const UEdGraphPin* ConnectedPin = ExistingState.Key.GetConnectedPin();
-    		if (ConnectedPin != Params.AssociatedPin1 && ConnectedPin != Params.AssociatedPin2)
-    		{
-    			continue;
-    		}
-
-    		const float DistThresholdSqr = 30.f * 30.f;
-			if (FVector2D::DistSquared(ExistingState.Value.LastStartPoint, Start) < DistThresholdSqr && FVector2D::DistSquared(ExistingState.Value.LastEndPoint, End) < DistThresholdSqr)
-			{
-				// Inherit our initial state from this existing thing, since it was probably a preview connector that got connected
-				NewWireState = ExistingState.Value;
-			}
-    	}
+	// Anything we've handed to the simulation that it hasn't got back to us on yet might still start things moving
+	return FWibblySimulation::Get().HasProcessedInput(GraphDrawState.LastChangedInputSerial) && (!GraphSnapshot || GraphSnapshot->IsAtRest());
+}
+
+void FWibblyConnectionDrawingPolicy::SubmitSimulationInputs()
+{
+	TArray<FWireInput> Inputs;
+	Inputs.Reserve(PendingWires.Num());
 
-    	WireState = &GraphState.Wires.Add(WireId, MoveTemp(NewWireState));
-    }
+	// Settled wires only need to be simulated again once something about them changes, so a graph that's sitting still
+	// sends nothing at all and the simulation can idle
+	const bool bSubmitAllVisible = bGraphWasHidden || !IsGraphAtRest();
 
-	// Clamp our tick rate to 30fps to avoid editor hitches hiding our animations, we'd rather they just pause
-	static const float MaxDeltaTime = 1.f / 30.f;
-	const float DeltaTime = FMath::Min(FSlateApplication::Get().GetDeltaTime(), MaxDeltaTime);
-    FVector2D CenterPoint = WireState->Update(Start, End, DeltaTime);
+	bool bAnyEndpointsChanged = false;
+	for (const FPendingWire& PendingWire : PendingWires)
+	{
+		FWireDrawCache& DrawCache = *PendingWire.DrawCache;
+		const bool bWasVisible = DrawCache.bWasVisible;
+		DrawCache.bWasVisible = !PendingWire.bIsCulled;
+
+		// Off-screen wires don't get simulated at all, they'll catch up once they're back in view
+		if (PendingWire.bIsCulled)
+		{
+			continue;
+		}
+
+		const bool bEndpointsChanged = DrawCache.SubmittedStartPoint != PendingWire.Start || DrawCache.SubmittedEndPoint != PendingWire.End;
+		if (bEndpointsChanged)
+		{
+			DrawCache.SubmittedStartPoint = PendingWire.Start;
+			DrawCache.SubmittedEndPoint = PendingWire.End;
+			bAnyEndpointsChanged = true;
+		}
+		else if (bWasVisible && !bSubmitAllVisible)
+		{
+			continue;
+		}
+
+		Inputs.Emplace(MakeWireId(PendingWire.Params.AssociatedPin1, PendingWire.Params.AssociatedPin2), PendingWire.Start, PendingWire.End);
+	}
+
+	if (Inputs.Num() > 0)
+	{
+		const uint64 Serial = FWibblySimulation::Get().SubmitInputs(GraphObj->GraphGuid, MoveTemp(Inputs), bGraphWasHidden);
+		if (bAnyEndpointsChanged)
+		{
+			GraphDrawState.LastChangedInputSerial = Serial;
+		}
+	}
+}
+
+void FWibblyConnectionDrawingPolicy::PrepareWire(FPendingWire& PendingWire, float ThicknessScale) const
+{
+	const FVectorType& P0 = PendingWire.Start;
+	const FVectorType& P1 = PendingWire.End;
+
+	PendingWire.WireThickness = PendingWire.Params.WireThickness * ThicknessScale;
+
+	FWireDrawCache& DrawCache = *PendingWire.DrawCache;
+	const FVectorType CenterPoint = PendingWire.CenterPoint;
+
+	// Skip wires that can't be seen entirely, judging by where they were last time plus some margin for them to swing
+	{
+		FBoxType LastBounds(ForceInit);
+		LastBounds += P0;
+		LastBounds += P1;
+		LastBounds += CenterPoint;
+		LastBounds = LastBounds.ExpandBy(WireCullMargin);
+
+		if (LastBounds.Max.X < ClippingRect.Left || LastBounds.Min.X > ClippingRect.Right || LastBounds.Max.Y < ClippingRect.Top || LastBounds.Min.Y > ClippingRect.Bottom)
+		{
+			PendingWire.bIsCulled = true;
+			return;
+		}
+	}
+
+	// Wires that look exactly like they did last time can skip straight to their cache
+	PendingWire.bIsDirty = DrawCache.CachedPoints.Num() == 0
+		|| DrawCache.CachedZoomFactor != ZoomFactor
+		|| DrawCache.CachedStartPoint != P0
+		|| DrawCache.CachedEndPoint != P1
+		|| DrawCache.CachedCenterPoint != CenterPoint;
 
 	// Don't need these anymore!
 	// const FVector2D SplineTangent = ComputeSplineTangent(P0, P1);
@@ -256,175 +550,227 @@ void FWibblyConnectionDrawingPolicy::DrawConnection(int32 LayerId, const FVector
 	// const FVector2D P1Tangent = (Params.EndDirection == EGPD_Input) ? SplineTangent : -SplineTangent;
 
 	// Magic number to get more of a bend
-	const FVector2D P0Tangent = (CenterPoint - P0) * 1.3f;
-	const FVector2D P1Tangent = (P1 - CenterPoint) * 1.3f;
+	const FVectorType P0Tangent = (CenterPoint - P0) * 1.3f;
+	const FVectorType P1Tangent = (P1 - CenterPoint) * 1.3f;
+	PendingWire.P0Tangent = P0Tangent;
+	PendingWire.P1Tangent = P1Tangent;
 
-	if (Settings->bTreatSplinesLikePins)
+	if (PendingWire.bIsDirty)
 	{
-		// Distance to consider as an overlap
-		const float QueryDistanceTriggerThresholdSquared = FMath::Square(Settings->SplineHoverTolerance + WireThickness * 0.5f);
-
-		// Distance to pass the bounding box cull test. This is used for the bCloseToSpline output that can be used as a
-		// dead zone to avoid mistakes caused by missing a double-click on a connection.
-		const float QueryDistanceForCloseSquared = FMath::Square(FMath::Sqrt(QueryDistanceTriggerThresholdSquared) + Settings->SplineCloseTolerance);
+		DrawCache.Tessellate(FWireCurve(P0, P0Tangent, P1, P1Tangent));
+		DrawCache.CachedZoomFactor = ZoomFactor;
+		DrawCache.CachedStartPoint = P0;
+		DrawCache.CachedEndPoint = P1;
+		DrawCache.CachedCenterPoint = CenterPoint;
+	}
 
-		bool bCloseToSpline = false;
-		{
-			// The curve will include the endpoints but can extend out of a tight bounds because of the tangents
-			// P0Tangent coefficient maximizes to 4/27 at a=1/3, and P1Tangent minimizes to -4/27 at a=2/3.
-			// const float MaximumTangentContribution = 4.0f / 27.0f;
+	// Arc lengths live as long as the tessellation, so clean wires reuse them too
+	const bool bNeedsArcLengths = PendingWire.Params.bDrawBubbles || MidpointImage != nullptr;
+	if (bNeedsArcLengths && DrawCache.CachedArcLengths.Num() == 0)
+	{
+		DrawCache.BuildArcLengths();
+	}
 
-			// Note (Geordie): If we don't use the engine's tangent limits then need to use full control-point bounds
-			const float MaximumTangentContribution = 1.f / 3.f;
-			FBox2D Bounds(ForceInit);
+	// The curve will include the endpoints but can extend out of a tight bounds because of the tangents
+	// P0Tangent coefficient maximizes to 4/27 at a=1/3, and P1Tangent minimizes to -4/27 at a=2/3.
+	// const float MaximumTangentContribution = 4.0f / 27.0f;
 
-			Bounds += FVector2D(P0);
-			Bounds += FVector2D(P0 + MaximumTangentContribution * P0Tangent);
-			Bounds += FVector2D(P1);
-			Bounds += FVector2D(P1 - MaximumTangentContribution * P1Tangent);
+	// Note (Geordie): If we don't use the engine's tangent limits then need to use full control-point bounds
+	const float MaximumTangentContribution = 1.f / 3.f;
+	FBoxType Bounds(ForceInit);
 
-			bCloseToSpline = Bounds.ComputeSquaredDistanceToPoint(LocalMousePosition) < QueryDistanceForCloseSquared;
+	Bounds += P0;
+	Bounds += P0 + MaximumTangentContribution * P0Tangent;
+	Bounds += P1;
+	Bounds += P1 - MaximumTangentContribution * P1Tangent;
+	PendingWire.Bounds = Bounds;
 
-			// Draw the bounding box for debugging
-#if 0
-#define DrawSpaceLine(Point1, Point2, DebugWireColor) {const FVector2D FakeTangent = (Point2 - Point1).GetSafeNormal(); FSlateDrawElement::MakeDrawSpaceSpline(DrawElementsList, LayerId, Point1, FakeTangent, Point2, FakeTangent, ClippingRect, 1.0f, ESlateDrawEffect::None, DebugWireColor); }
+	// Each wire near the mouse finds its own closest approach here, ResolveHover just picks between them
+	if (Settings->bTreatSplinesLikePins)
+	{
+		const FVectorType MousePosition(LocalMousePosition);
+		float OverlapDistanceSquared, CloseDistanceSquared;
+		GetHoverDistancesSquared(PendingWire.WireThickness, OverlapDistanceSquared, CloseDistanceSquared);
+		PendingWire.bIsHoverCandidate = Bounds.ComputeSquaredDistanceToPoint(MousePosition) < CloseDistanceSquared;
 
-			if (bCloseToSpline)
-			{
-				const FLinearColor BoundsWireColor = bCloseToSpline ? FLinearColor::Green : FLinearColor::White;
+		if (PendingWire.bIsHoverCandidate)
+		{
+			// Find the closest approach to the spline
+			const int32 NumStepsToTest = 16;
+			const FWireCurve Curve(P0, P0Tangent, P1, P1Tangent);
+			PendingWire.ClosestDistanceSquared = Curve.FindClosestPoint(MousePosition, NumStepsToTest, PendingWire.ClosestPoint);
+			PendingWire.bIsOverlapping = PendingWire.ClosestDistanceSquared < OverlapDistanceSquared;
+			PendingWire.bCloseToSpline = PendingWire.ClosestDistanceSquared < CloseDistanceSquared;
+		}
+	}
+}
 
-				FVector2D TL = Bounds.Min;
-				FVector2D BR = Bounds.Max;
-				FVector2D TR = FVector2D(Bounds.Max.X, Bounds.Min.Y);
-				FVector2D BL = FVector2D(Bounds.Min.X, Bounds.Max.Y);
+void FWibblyConnectionDrawingPolicy::GetHoverDistancesSquared(float WireThickness, float& OutOverlapDistanceSquared, float& OutCloseDistanceSquared) const
+{
+	// Distance to consider as an overlap
+	OutOverlapDistanceSquared = FMath::Square(Settings->SplineHoverTolerance + WireThickness * 0.5f);
 
-				DrawSpaceLine(TL, TR, BoundsWireColor);
-				DrawSpaceLine(TR, BR, BoundsWireColor);
-				DrawSpaceLine(BR, BL, BoundsWireColor);
-				DrawSpaceLine(BL, TL, BoundsWireColor);
-			}
-#endif
-		}
+	// Distance to pass the bounding box cull test. This is used for the bCloseToSpline output that can be used as a
+	// dead zone to avoid mistakes caused by missing a double-click on a connection.
+	OutCloseDistanceSquared = FMath::Square(FMath::Sqrt(OutOverlapDistanceSquared) + Settings->SplineCloseTolerance);
+}
 
-		if (bCloseToSpline)
-		{
-			// Find the closest approach to the spline
-			FVector2D ClosestPoint(ForceInit);
-			float ClosestDistanceSquared = FLT_MAX;
+void FWibblyConnectionDrawingPolicy::ResolveHover()
+{
+	if (!Settings->bTreatSplinesLikePins)
+	{
+		return;
+	}
 
-			const int32 NumStepsToTest = 16;
-			const float StepInterval = 1.0f / (float)NumStepsToTest;
-			FVector2D Point1 = FMath::CubicInterp(P0, P0Tangent, P1, P1Tangent, 0.0f);
-			for (float TestAlpha = 0.0f; TestAlpha < 1.0f; TestAlpha += StepInterval)
-			{
-				const FVector2D Point2 = FMath::CubicInterp(P0, P0Tangent, P1, P1Tangent, TestAlpha + StepInterval);
+	WIBBLY_SCOPE(STAT_WibblyWires_HoverTest);
 
-				const FVector2D ClosestPointToSegment = FMath::ClosestPointOnSegment2D(LocalMousePosition, Point1, Point2);
-				const float DistanceSquared = (LocalMousePosition - ClosestPointToSegment).SizeSquared();
+	int32 NumCandidates = 0;
 
-				if (DistanceSquared < ClosestDistanceSquared)
-				{
-					ClosestDistanceSquared = DistanceSquared;
-					ClosestPoint = ClosestPointToSegment;
-				}
+	// Take the closest overlapping wire, this is the same result as recording them one at a time in draw order
+	for (const FPendingWire& PendingWire : PendingWires)
+	{
+		if (!PendingWire.bIsHoverCandidate)
+		{
+			continue;
+		}
 
-				Point1 = Point2;
-			}
+		NumCandidates++;
 
-			// Record the overlap
-			if (ClosestDistanceSquared < QueryDistanceTriggerThresholdSquared)
+		if (PendingWire.bIsOverlapping)
+		{
+			if (PendingWire.ClosestDistanceSquared < SplineOverlapResult.GetDistanceSquared())
 			{
-				if (ClosestDistanceSquared < SplineOverlapResult.GetDistanceSquared())
-				{
-					const float SquaredDistToPin1 = (Params.AssociatedPin1 != nullptr) ? (P0 - ClosestPoint).SizeSquared() : FLT_MAX;
-					const float SquaredDistToPin2 = (Params.AssociatedPin2 != nullptr) ? (P1 - ClosestPoint).SizeSquared() : FLT_MAX;
+				const FConnectionParams& Params = PendingWire.Params;
+				const float SquaredDistToPin1 = (Params.AssociatedPin1 != nullptr) ? (PendingWire.Start - PendingWire.ClosestPoint).SizeSquared() : FLT_MAX;
+				const float SquaredDistToPin2 = (Params.AssociatedPin2 != nullptr) ? (PendingWire.End - PendingWire.ClosestPoint).SizeSquared() : FLT_MAX;
 
-					SplineOverlapResult = FGraphSplineOverlapResult(Params.AssociatedPin1, Params.AssociatedPin2, ClosestDistanceSquared, SquaredDistToPin1, SquaredDistToPin2, true);
-				}
-			}
-			else if (ClosestDistanceSquared < QueryDistanceForCloseSquared)
-			{
-				SplineOverlapResult.SetCloseToSpline(true);
+				SplineOverlapResult = FGraphSplineOverlapResult(Params.AssociatedPin1, Params.AssociatedPin2, PendingWire.ClosestDistanceSquared, SquaredDistToPin1, SquaredDistToPin2, true);
 			}
 		}
+		else if (PendingWire.bCloseToSpline)
+		{
+			SplineOverlapResult.SetCloseToSpline(true);
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_WibblyWires_HoverCandidates, NumCandidates);
+}
+
+void FWibblyConnectionDrawingPolicy::EmitWire(const FPendingWire& PendingWire)
+{
+	const int32 LayerId = PendingWire.LayerId;
+	const FConnectionParams& Params = PendingWire.Params;
+	const FVectorType& P0 = PendingWire.Start;
+	const FVectorType& P1 = PendingWire.End;
+	const FVectorType& P0Tangent = PendingWire.P0Tangent;
+	const FVectorType& P1Tangent = PendingWire.P1Tangent;
+
+	// Draw the bounding box for debugging
+#if 0
+#define DrawSpaceLine(Point1, Point2, DebugWireColor) {const FVector2D FakeTangent = (Point2 - Point1).GetSafeNormal(); FSlateDrawElement::MakeDrawSpaceSpline(DrawElementsList, LayerId, Point1, FakeTangent, Point2, FakeTangent, ClippingRect, 1.0f, ESlateDrawEffect::None, DebugWireColor); }
+
+	if (PendingWire.bCloseToSpline)
+	{
+		const FLinearColor BoundsWireColor = PendingWire.bCloseToSpline ? FLinearColor::Green : FLinearColor::White;
+
+		FVector2D TL = FVector2D(PendingWire.Bounds.Min);
+		FVector2D BR = FVector2D(PendingWire.Bounds.Max);
+		FVector2D TR = FVector2D(PendingWire.Bounds.Max.X, PendingWire.Bounds.Min.Y);
+		FVector2D BL = FVector2D(PendingWire.Bounds.Min.X, PendingWire.Bounds.Max.Y);
+
+		DrawSpaceLine(TL, TR, BoundsWireColor);
+		DrawSpaceLine(TR, BR, BoundsWireColor);
+		DrawSpaceLine(BR, BL, BoundsWireColor);
+		DrawSpaceLine(BL, TL, BoundsWireColor);
 	}
+#endif
 
-	// Draw the spline itself
-	FSlateDrawElement::MakeDrawSpaceSpline(
+	// Draw the spline itself, from the tessellation cached on the wire
+	FSlateDrawElement::MakeLines(
 		DrawElementsList,
 		LayerId,
-		P0, P0Tangent,
-		P1, P1Tangent,
-		WireThickness,
+		FPaintGeometry(),
+		PendingWire.DrawCache->CachedPoints,
 		ESlateDrawEffect::None,
-		Params.WireColor
+		Params.WireColor,
+		true, // bAntiAlias
+		PendingWire.WireThickness
 	);
 
-	if (Params.bDrawBubbles || (MidpointImage != nullptr))
+	// Draw the midpoint image
+	if (MidpointImage != nullptr)
 	{
-		// This table maps distance along curve to alpha
-		FInterpCurve<float> SplineReparamTable;
-		const float SplineLength = MakeSplineReparamTable(P0, P0Tangent, P1, P1Tangent, SplineReparamTable);
-
-		// Draw bubbles on the spline
-		if (Params.bDrawBubbles)
+		// Cached arc lengths map distance along the curve back to alpha
+		const TArray<float>& ArcLengths = PendingWire.DrawCache->CachedArcLengths;
+		const FWireCurve Curve(P0, P0Tangent, P1, P1Tangent);
+
+		// Determine the spline position and exact slope for the midpoint (to orient the midpoint image to the spline)
+		const float HalfLength = PendingWire.DrawCache->GetLength() * 0.5f;
+		float MidpointAlpha = 0.f;
+		EvalSortedArcLengths(ArcLengths, MakeArrayView(&HalfLength, 1), MakeArrayView(&MidpointAlpha, 1));
+		FVectorType Midpoint;
+		FVectorType Slope;
+		Curve.EvalWithDerivative(MidpointAlpha, Midpoint, Slope);
+
+		float SinAngle = 0.f;
+		float CosAngle = 1.f;
+		const float SlopeSizeSquared = Slope.SizeSquared();
+		if (SlopeSizeSquared > SMALL_NUMBER)
 		{
-			const float BubbleSpacing = 64.f * ZoomFactor;
-			const float BubbleSpeed = 192.f * ZoomFactor;
-			const FVector2D BubbleSize = BubbleImage->ImageSize * ZoomFactor * 0.2f * Params.WireThickness;
-
-			float Time = (FPlatformTime::Seconds() - GStartTime);
-			const float BubbleOffset = FMath::Fmod(Time * BubbleSpeed, BubbleSpacing);
-			const int32 NumBubbles = FMath::CeilToInt(SplineLength/BubbleSpacing);
-			for (int32 i = 0; i < NumBubbles; ++i)
-			{
-				const float Distance = ((float)i * BubbleSpacing) + BubbleOffset;
-				if (Distance < SplineLength)
-				{
-					const float Alpha = SplineReparamTable.Eval(Distance, 0.f);
-					FVector2D BubblePos = FMath::CubicInterp(P0, P0Tangent, P1, P1Tangent, Alpha);
-					BubblePos -= (BubbleSize * 0.5f);
-
-					FSlateDrawElement::MakeBox(
-						DrawElementsList,
-						LayerId,
-						FPaintGeometry( BubblePos, BubbleSize, ZoomFactor  ),
-						BubbleImage,
-						ESlateDrawEffect::None,
-						Params.WireColor
-						);
-				}
-			}
+			const float InvSlopeSize = FMath::InvSqrt(SlopeSizeSquared);
+			SinAngle = Slope.Y * InvSlopeSize;
+			CosAngle = Slope.X * InvSlopeSize;
 		}
 
-		// Draw the midpoint image
-		if (MidpointImage != nullptr)
+		// Draw the arrow, rotated about its center. The rotation goes straight into the render transform
+		// so we never need to round-trip through an angle.
+		const FVector2D MidpointDrawPos = FVector2D(Midpoint) - MidpointRadius;
+		const FVector2D LocalSize = MidpointImage->ImageSize;
+		const FVector2D LocalCenter = LocalSize * 0.5f;
+		const FVector2D RotatedCenter(LocalCenter.X * CosAngle - LocalCenter.Y * SinAngle, LocalCenter.X * SinAngle + LocalCenter.Y * CosAngle);
+		const FVector2D Translation = MidpointDrawPos + (LocalCenter - RotatedCenter) * ZoomFactor;
+		const FSlateRenderTransform ArrowRenderTransform(
+			FMatrix2x2(CosAngle * ZoomFactor, SinAngle * ZoomFactor, -SinAngle * ZoomFactor, CosAngle * ZoomFactor),
+			FVectorType(Translation));
+
+		FSlateDrawElement::MakeBox(
+			DrawElementsList,
+			LayerId,
+			FPaintGeometry(FSlateLayoutTransform(ZoomFactor, MidpointDrawPos), ArrowRenderTransform, LocalSize, true),
+			MidpointImage,
+			ESlateDrawEffect::None,
+			Params.WireColor
+			);
+	}
+}
+
+void FWibblyConnectionDrawingPolicy::EmitBubbles(const FPendingWire& PendingWire)
+{
+	const FConnectionParams& Params = PendingWire.Params;
+	const float SplineLength = PendingWire.DrawCache->GetLength();
+
+	const float BubbleSpacing = 64.f * ZoomFactor;
+	const float BubbleSpeed = 192.f * ZoomFactor;
+	const FVectorType BubbleSize = FVectorType(BubbleImage->ImageSize * ZoomFactor * 0.2f * Params.WireThickness);
+
+	float Time = (FPlatformTime::Seconds() - GStartTime);
+	const float BubbleOffset = FMath::Fmod(Time * BubbleSpeed, BubbleSpacing);
+	const int32 NumBubbles = FMath::CeilToInt(SplineLength/BubbleSpacing);
+
+	BubbleDistances.Reset();
+	for (int32 i = 0; i < NumBubbles; ++i)
+	{
+		const float Distance = ((float)i * BubbleSpacing) + BubbleOffset;
+		if (Distance < SplineLength)
 		{
-			// Determine the spline position for the midpoint
-			const float MidpointAlpha = SplineReparamTable.Eval(SplineLength * 0.5f, 0.f);
-			const FVector2D Midpoint = FMath::CubicInterp(P0, P0Tangent, P1, P1Tangent, MidpointAlpha);
-
-			// Approximate the slope at the midpoint (to orient the midpoint image to the spline)
-			const FVector2D MidpointPlusE = FMath::CubicInterp(P0, P0Tangent, P1, P1Tangent, MidpointAlpha + KINDA_SMALL_NUMBER);
-			const FVector2D MidpointMinusE = FMath::CubicInterp(P0, P0Tangent, P1, P1Tangent, MidpointAlpha - KINDA_SMALL_NUMBER);
-			const FVector2D SlopeUnnormalized = MidpointPlusE - MidpointMinusE;
-
-			// Draw the arrow
-			const FVector2D MidpointDrawPos = Midpoint - MidpointRadius;
-			const float AngleInRadians = SlopeUnnormalized.IsNearlyZero() ? 0.0f : FMath::Atan2(SlopeUnnormalized.Y, SlopeUnnormalized.X);
-
-			FSlateDrawElement::MakeRotatedBox(
-				DrawElementsList,
-				LayerId,
-				FPaintGeometry(MidpointDrawPos, MidpointImage->ImageSize * ZoomFactor, ZoomFactor),
-				MidpointImage,
-				ESlateDrawEffect::None,
-				AngleInRadians,
-				TOptional<FVector2D>(),
-				FSlateDrawElement::RelativeToElement,
-				Params.WireColor
-				);
+			BubbleDistances.Add(Distance);
 		}
 	}
 
-}
\ No newline at end of file
+	// Distances are ascending, so resolve every alpha in one walk over the cached arc lengths and then evaluate them all together
+	BubbleAlphas.SetNumUninitialized(BubbleDistances.Num());
+	EvalSortedArcLengths(PendingWire.DrawCache->CachedArcLengths, BubbleDistances, BubbleAlphas);
+	FWireCurve(PendingWire.Start, PendingWire.P0Tangent, PendingWire.End, PendingWire.P1Tangent).EvalMany(BubbleAlphas, BubblePositions);
+
+	AddBubbles(PendingWire.LayerId, BubblePositions, BubbleSize, Params.WireColor);
+}
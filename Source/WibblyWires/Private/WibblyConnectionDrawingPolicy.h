@@ -5,82 +5,83 @@
 #include "CoreMinimal.h"
 #include "BlueprintConnectionDrawingPolicy.h"
 #include "ConnectionDrawingPolicy.h"
-#include "Verlet.h"
+#include "WibblyGraphState.h"
+#include "WireCurve.h"
 #include "EdGraphUtilities.h"
-#include "Engine/SpringInterpolator.h"
 
-struct FWireId
+// What the drawing policy keeps for a wire between paints
+struct FWireDrawCache
 {
-	FWireId(UEdGraphPin* InStartPin, UEdGraphPin* InEndPin)
-	: StartPin(InStartPin)
-	, EndPin(InEndPin)
-	, StartPinHandle(FGraphPinHandle(InStartPin))
-	, EndPinHandle(FGraphPinHandle(InEndPin))
+	// Line strip for the wire from the last time it was dirty, reused while it looks the same
+	TArray<FVectorType> CachedPoints;
+	// Arc length at each of CachedPoints, for placing bubbles and the midpoint arrow. Only built for wires that have them.
+	TArray<float> CachedArcLengths;
+	FVectorType CachedStartPoint;
+	FVectorType CachedEndPoint;
+	FVectorType CachedCenterPoint;
+	float CachedZoomFactor = 0.f;
+
+	// The FGraphDrawState::DrawPass this wire was last drawn in, so caches for wires that have gone can be dropped
+	uint32 LastDrawPass = 0;
+
+	// Endpoints last handed to the simulation
+	FVectorType SubmittedStartPoint = FVectorType::ZeroVector;
+	FVectorType SubmittedEndPoint = FVectorType::ZeroVector;
+	// Whether the wire was on screen in the last draw pass, so one coming back into view is handed to the simulation again
+	bool bWasVisible = false;
+
+	void Tessellate(const FWireCurve& Curve);
+	void BuildArcLengths();
+
+	float GetLength() const
 	{
-		uint32 StartHash = StartPin ? GetTypeHash(StartPin->PinId) : 0;
-		uint32 EndHash = EndPin ? GetTypeHash(EndPin->PinId) : 0;
-		Hash = HashCombine(StartHash, EndHash);
+		return CachedArcLengths.Num() > 0 ? CachedArcLengths.Last() : 0.f;
 	}
-
-	FORCEINLINE bool operator ==(const FWireId& Other) const
-	{
-		return StartPin == Other.StartPin && EndPin == Other.EndPin;
-	}
-
-	FORCEINLINE bool operator !=(const FWireId& Other) const
-	{
-		return StartPin != Other.StartPin && EndPin != Other.EndPin;
-	}
-
-	friend uint32 GetTypeHash(const FWireId& WireId)
-	{
-		return WireId.Hash;
-	}
-
-	bool IsPreviewConnector() const
-	{
-		return StartPin == nullptr || EndPin == nullptr;
-	}
-
-	const UEdGraphPin* GetConnectedPin() const
-	{
-		return StartPin == nullptr ? EndPin : StartPin;
-	}
-
-public:
-	const UEdGraphPin* StartPin;
-	const UEdGraphPin* EndPin;
-	FGraphPinHandle StartPinHandle;
-	FGraphPinHandle EndPinHandle;
-
-private:
-	uint32 Hash;
 };
 
-struct FWireState
+// A connection gathered during the draw pass, along with everything worked out for it before it's emitted
+struct FPendingWire
 {
-	float DesiredRopeLength;
-	float LerpedRopeLength;
-	FVector2D DesiredRopeCenterPoint;
-	FRK4SpringInterpolator<FVector> SpringCenterPoint;
-	float DesiredSlackMultiplier;
-	FVector2D LastStartPoint;
-	FVector2D LastEndPoint;
-	FLinearColor Color;
-
-	FWireState() = default;
-	FWireState(FVector2D StartPoint, FVector2D EndPoint, float SpringStiffness, float SpringDampeningRatio, float InDesiredSlackMultiplier);
-
-	FVector2D CalculateDesiredCenterPointWithRopeLengthDelta(FVector2D StartPoint, FVector2D EndPoint, float RopeLengthDelta);
-	FVector2D CalculateDesiredCenterPoint(FVector2D StartPoint, FVector2D EndPoint);
-	float CalculateDesiredRopeLength(FVector2D StartPoint, FVector2D EndPoint);
-	FVector2D Update(FVector2D StartPoint, FVector2D EndPoint, float DeltaTime);
+	int32 LayerId = 0;
+	// Positions are single precision, converted from Slate's FVector2D as they come in and back again as they go out
+	FVectorType Start = FVectorType::ZeroVector;
+	FVectorType End = FVectorType::ZeroVector;
+	FConnectionParams Params;
+	FWireDrawCache* DrawCache = nullptr;
+	FVectorType CenterPoint = FVectorType::ZeroVector;
+
+	FVectorType P0Tangent = FVectorType::ZeroVector;
+	FVectorType P1Tangent = FVectorType::ZeroVector;
+	float WireThickness = 0.f;
+	FBoxType Bounds = FBoxType(ForceInit);
+
+	FVectorType ClosestPoint = FVectorType::ZeroVector;
+	float ClosestDistanceSquared = FLT_MAX;
+	// Whether the mouse is close enough to the wire's bounds for it to be worth testing against the curve itself
+	bool bIsHoverCandidate = false;
+	bool bIsCulled = false;
+	bool bIsDirty = true;
+	bool bIsOverlapping = false;
+	bool bCloseToSpline = false;
 };
 
-struct FGraphState
+// What the drawing policies keep for a graph between paints, only ever touched on the game thread
+struct FGraphDrawState
 {
-	TMap<FWireId, FWireState> Wires;
-	FVerletState VerletWires;
+	TMap<FWireId, FWireDrawCache> Wires;
+
+	// Counts full draws of the graph, so we can tell which wires weren't part of the last one
+	uint32 DrawPass = 0;
+
+	// When the graph was last drawn, graphs that go unseen for long enough get evicted
+	double LastDrawnTime = 0.0;
+
+	// Serial of the last input batch that moved any endpoints, so we know to keep painting until the simulation has seen it
+	uint64 LastChangedInputSerial = 0;
+
+	// Path of the graph this belongs to, only kept so reports can say which Blueprint is which
+	FString GraphName;
+	FWibblyTimingHistory DrawTimes;
 };
 
 /**
@@ -108,11 +109,48 @@ public:
 	};
 
 	FWibblyConnectionDrawingPolicy(int32 InBackLayerID, int32 InFrontLayerID, float InZoomFactor, const FSlateRect& InClippingRect, FSlateWindowElementList& InDrawElements, UEdGraph* InGraphObj);
+	virtual ~FWibblyConnectionDrawingPolicy() override;
 
+	virtual void Draw(TMap<TSharedRef<SWidget>, FArrangedWidget>& InPinGeometries, FArrangedChildren& ArrangedNodes) override;
+	virtual void DrawPinGeometries(TMap<TSharedRef<SWidget>, FArrangedWidget>& InPinGeometries, FArrangedChildren& ArrangedNodes) override;
 	virtual void DrawConnection(int32 LayerId, const FVector2D& Start, const FVector2D& End, const FConnectionParams& Params) override;
 
 private:
 
+	// Processes everything gathered so far in phases: find draw caches and simulation results, build every curve, resolve hover,
+	// hand the endpoints to the simulation, then emit lines and bubbles
+	void DrawPendingWires();
+	void ResolveDrawCaches();
+	// Drops the caches of wires that weren't in the last couple of full draws, i.e. ones that have been deleted
+	void PruneDrawCaches(int32 NumDrawnWires);
+	void PrepareWire(FPendingWire& PendingWire, float ThicknessScale) const;
+	void ResolveHover();
+	void GetHoverDistancesSquared(float WireThickness, float& OutOverlapDistanceSquared, float& OutCloseDistanceSquared) const;
+	// Hands the simulation the wires it has something to do for: new ones, ones back in view, ones whose endpoints moved,
+	// and every visible wire while the graph is still settling or after it's been hidden for a while
+	void SubmitSimulationInputs();
+	// Whether the simulation has seen everything we've handed it and reported nothing moving
+	bool IsGraphAtRest() const;
+	void EmitWire(const FPendingWire& PendingWire);
+	void EmitBubbles(const FPendingWire& PendingWire);
+
+	// Queues bubble quads centered on the given positions, so every bubble in the graph goes out as one element
+	void AddBubbles(int32 LayerId, TArrayView<const FVectorType> Positions, const FVectorType& BubbleSize, const FLinearColor& Color);
+	void FlushBubbles();
+
+	// Registers an active timer on the window we're painting into while anything is still moving, so Slate keeps
+	// repainting until the wires settle and can go idle once they have
+	void KeepRepaintingWhileMoving();
+
 	UEdGraph* GraphObj;
-	FGraphState& GraphState;
+	FGraphDrawState& GraphDrawState;
+	const FGraphSnapshot* GraphSnapshot;
+
+	TArray<FPendingWire> PendingWires;
+	bool bGatheringWires = false;
+	// Whether the graph went undrawn for longer than WibblyWires.CatchUpThreshold before this draw
+	bool bGraphWasHidden = false;
+
+	FSlateResourceHandle BubbleResourceHandle;
+	int32 BubbleLayerId = INDEX_NONE;
 };
@@ -0,0 +1,129 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WibblyGraphState.h"
+
+#include "HAL/PlatformTime.h"
+
+void FGraphState::ApplyInputBatch(const FWireInputBatch& Batch, double CurrentTime)
+{
+	for (const FWireInput& Input : Batch.Wires)
+	{
+		FWireState& WireState = FindOrAddWireState(Input, CurrentTime);
+		WireState.SetTargets(Input.StartPoint, Input.EndPoint);
+		WireState.bWasDrawn = true;
+		if (Batch.bWasHidden)
+		{
+			WireState.bIsSettled = false;
+		}
+	}
+
+	bHasDrawnWires |= Batch.Wires.Num() > 0;
+}
+
+bool FGraphState::Step(EWibblySimulationQuality Quality, double CurrentTime, float DeltaTime, double DeadlineSeconds)
+{
+	if (!bHasDrawnWires && VerletWires.GetNumChains() == 0)
+	{
+		// Undrawn wires stop where they are, so the only thing that can change is that they're no longer counted as moving
+		const bool bWasMoving = NumMovingWires > 0;
+		NumMovingWires = 0;
+		return bWasMoving;
+	}
+
+	bHasDrawnWires = false;
+	const bool bHadMovingWires = NumMovingWires > 0;
+	const bool bHadChains = VerletWires.GetNumChains() > 0;
+	const double StepStartTime = FPlatformTime::Seconds();
+	const bool bStaticWires = Quality >= EWibblySimulationQuality::StaticWires;
+	int32 NumMoving = 0;
+	int32 NumSimulatedWires = 0;
+
+	{
+		WIBBLY_SCOPE(STAT_WibblyWires_UpdateWires);
+
+		for (auto& WirePair : Wires)
+		{
+			// Only simulate wires that were drawn since we last stepped, anything else catches up when it's next seen
+			FWireState& WireState = WirePair.Value;
+			if (!WireState.bWasDrawn)
+			{
+				continue;
+			}
+
+			WireState.bWasDrawn = false;
+
+			// Drawn again exactly where it came to rest, so there's nothing to do
+			if (WireState.bIsSettled && !WireState.bTargetsMoved)
+			{
+				continue;
+			}
+
+			NumSimulatedWires++;
+			const FWireParams Params = FWireParams::FromHash(GetTypeHash(WirePair.Key), WirePair.Key.IsPreviewConnector());
+			if (bStaticWires)
+			{
+				WireState.SnapToRest(CurrentTime, Params);
+			}
+			else
+			{
+				NumMoving += WireState.Simulate(CurrentTime, DeltaTime, Params) ? 1 : 0;
+			}
+		}
+
+		INC_DWORD_STAT_BY(STAT_WibblyWires_WiresSimulated, NumSimulatedWires);
+	}
+
+	NumMovingWires = NumMoving;
+
+	const int32 Substeps = Quality >= EWibblySimulationQuality::ReducedSubsteps ? FVerletChain::ReducedSubsteps : FVerletChain::DefaultSubsteps;
+	if (Quality >= EWibblySimulationQuality::TimeSlicedChains)
+	{
+		VerletWires.UpdateVerletChainsTimeSliced(DeltaTime, Substeps, DeadlineSeconds);
+	}
+	else
+	{
+		VerletWires.UpdateVerletChains(DeltaTime, Substeps);
+	}
+
+	UpdateTimes.AddSample(FPlatformTime::Seconds() - StepStartTime);
+
+	const bool bChanged = NumSimulatedWires > 0 || bHasNewWires || bHadMovingWires || bHadChains;
+	bHasNewWires = false;
+	return bChanged;
+}
+
+FWireState& FGraphState::FindOrAddWireState(const FWireInput& Input, double CurrentTime)
+{
+	if (FWireState* ExistingWireState = Wires.Find(Input.WireId))
+	{
+		return *ExistingWireState;
+	}
+
+	const FWireParams Params = FWireParams::FromHash(GetTypeHash(Input.WireId), Input.WireId.IsPreviewConnector());
+	FWireState NewWireState(Input.StartPoint, Input.EndPoint, Params);
+
+	for (const auto& ExistingState : Wires)
+	{
+		if (!ExistingState.Key.IsPreviewConnector())
+		{
+			continue;
+		}
+
+		const FGuid& ConnectedPinId = ExistingState.Key.GetConnectedPinId();
+		if (ConnectedPinId != Input.WireId.StartPinId && ConnectedPinId != Input.WireId.EndPinId)
+		{
+			continue;
+		}
+
+		const float DistThresholdSqr = 30.f * 30.f;
+		if (FVectorType::DistSquared(ExistingState.Value.TargetStartPoint, Input.StartPoint) < DistThresholdSqr && FVectorType::DistSquared(ExistingState.Value.TargetEndPoint, Input.EndPoint) < DistThresholdSqr)
+		{
+			// Inherit our initial state from this existing thing, since it was probably a preview connector that got connected
+			NewWireState = ExistingState.Value;
+		}
+	}
+
+	NewWireState.LastSimulatedTime = CurrentTime;
+	bHasNewWires = true;
+	return Wires.Add(Input.WireId, MoveTemp(NewWireState));
+}
@@ -0,0 +1,152 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Verlet.h"
+#include "WibblyTypes.h"
+#include "WibblyWiresStats.h"
+#include "WireState.h"
+
+// Everything the simulation keeps for a graph and the inputs it's stepped with. Like WireState.h and Verlet.h this only
+// needs Core, so a graph can be stepped without Slate or the editor, which is how replays and the standalone tests run it.
+
+// Identifies a wire by the pins at either end. Pins are referred to by their PinId rather than by pointer, so an id means
+// the same thing on any thread, in a recording, or with no editor around at all. A zero guid stands in for a missing pin,
+// i.e. the free end of a preview connector.
+struct FWireId
+{
+	FWireId(const FGuid& InStartPinId, const FGuid& InEndPinId)
+		: StartPinId(InStartPinId)
+		, EndPinId(InEndPinId)
+	{
+		uint32 StartHash = StartPinId.IsValid() ? GetTypeHash(StartPinId) : 0;
+		uint32 EndHash = EndPinId.IsValid() ? GetTypeHash(EndPinId) : 0;
+		Hash = HashCombine(StartHash, EndHash);
+	}
+
+	FORCEINLINE bool operator ==(const FWireId& Other) const
+	{
+		return StartPinId == Other.StartPinId && EndPinId == Other.EndPinId;
+	}
+
+	FORCEINLINE bool operator !=(const FWireId& Other) const
+	{
+		return !(*this == Other);
+	}
+
+	friend uint32 GetTypeHash(const FWireId& WireId)
+	{
+		return WireId.Hash;
+	}
+
+	bool IsPreviewConnector() const
+	{
+		return !StartPinId.IsValid() || !EndPinId.IsValid();
+	}
+
+	const FGuid& GetConnectedPinId() const
+	{
+		return StartPinId.IsValid() ? StartPinId : EndPinId;
+	}
+
+	// Stands in for a recorded wire, where pins were swapped for small integer keys to keep recordings compact.
+	// Keys are only ever compared against each other, with 0 standing in for a missing pin.
+	// The recorded hash is kept as is, since the wire's variance is derived from it.
+	static FWireId MakeReplayId(uint32 StartKey, uint32 EndKey, uint32 RecordedHash)
+	{
+		FWireId WireId(FGuid(0, 0, 0, StartKey), FGuid(0, 0, 0, EndKey));
+		WireId.Hash = RecordedHash;
+		return WireId;
+	}
+
+public:
+	FGuid StartPinId;
+	FGuid EndPinId;
+
+private:
+	uint32 Hash;
+};
+
+// Endpoints a wire was drawn with this frame
+struct FWireInput
+{
+	FWireId WireId;
+	FVectorType StartPoint;
+	FVectorType EndPoint;
+
+	FWireInput(const FWireId& InWireId, const FVectorType& InStartPoint, const FVectorType& InEndPoint)
+		: WireId(InWireId)
+		, StartPoint(InStartPoint)
+		, EndPoint(InEndPoint)
+	{
+	}
+};
+
+// Everything one drawing policy saw for a graph, handed to the simulation in one go
+struct FWireInputBatch
+{
+	FGuid GraphGuid;
+	uint64 Serial = 0;
+	// Whether the graph went undrawn for a while before this, in which case every wire in it catches up on the time it
+	// missed. Otherwise wires that had settled were only left out because nothing about them changed.
+	bool bWasHidden = false;
+	TArray<FWireInput> Wires;
+};
+
+// How far the simulation has had to back off to stay within WibblyWires.FrameBudgetMs, each level includes the ones before it
+enum class EWibblySimulationQuality : uint8
+{
+	Full,
+	TimeSlicedChains,
+	ReducedSubsteps,
+	StaticWires,
+};
+
+// Simulation state for a whole graph, only ever touched by whatever is stepping it (the simulation task, or a replay)
+struct FGraphState
+{
+	TMap<FWireId, FWireState> Wires;
+	FVerletState VerletWires;
+
+	// How many wires were still settling as of the last simulation step
+	int32 NumMovingWires = 0;
+
+	// Left to whoever owns this, the live simulation keeps the step that last changed anything here so it only
+	// republishes graphs that have actually moved
+	uint64 LastChangedStep = 0;
+
+	FWibblyTimingHistory UpdateTimes;
+
+	// Takes on the endpoints every wire in the batch was drawn with, adding any wires we haven't seen before
+	void ApplyInputBatch(const FWireInputBatch& Batch, double CurrentTime);
+	// Simulates the wires drawn since the last step and updates the chains, cutting whatever corners Quality allows.
+	// Returns whether anything changed: a wire was added, moved or stopped moving, or there were chains to update.
+	bool Step(EWibblySimulationQuality Quality, double CurrentTime, float DeltaTime, double DeadlineSeconds);
+
+	bool IsMoving() const
+	{
+		return NumMovingWires > 0 || VerletWires.GetNumChains() > 0;
+	}
+
+private:
+	FWireState& FindOrAddWireState(const FWireInput& Input, double CurrentTime);
+
+	bool bHasDrawnWires = false;
+	bool bHasNewWires = false;
+};
+
+// Immutable results of one simulation step for a graph, read by the drawing policies
+struct FGraphSnapshot
+{
+	TMap<FWireId, FVectorType> CenterPoints;
+	int32 NumMovingWires = 0;
+	int32 NumVerletChains = 0;
+	// FGraphState::LastChangedStep as of when this was built, so a buffer can tell whether it's behind
+	uint64 LastChangedStep = 0;
+
+	bool IsAtRest() const
+	{
+		return NumMovingWires == 0 && NumVerletChains == 0;
+	}
+};
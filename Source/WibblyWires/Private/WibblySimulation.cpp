@@ -0,0 +1,511 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WibblySimulation.h"
+#include "WibblyWiresStats.h"
+#include "WireRecording.h"
+
+#include "Framework/Application/SlateApplication.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+static float FrameBudgetMs = 2.f;
+FAutoConsoleVariableRef CVarFrameBudgetMs(
+	TEXT("WibblyWires.FrameBudgetMs"),
+	FrameBudgetMs,
+	TEXT("How many milliseconds the wire simulation can take per frame before it starts cutting corners to stay within it")
+);
+
+static float EvictAfterSeconds = 120.f;
+FAutoConsoleVariableRef CVarEvictAfterSeconds(
+	TEXT("WibblyWires.EvictAfterSeconds"),
+	EvictAfterSeconds,
+	TEXT("How long a graph can go without being drawn before its wires are forgotten, they start over from rest if it's drawn again. 0 keeps them forever.")
+);
+
+FAutoConsoleCommandWithOutputDevice CVarWibblyWiresStats(
+	TEXT("WibblyWires.Stats"),
+	TEXT("Prints wire counts, memory and recent update/draw timings for every graph the simulation knows about"),
+	FConsoleCommandWithOutputDeviceDelegate::CreateLambda([](FOutputDevice& Ar)
+	{
+		FWibblySimulation::Get().DumpStats(Ar);
+	})
+);
+
+FAutoConsoleCommand CVarWibblyWiresRecord(
+	TEXT("WibblyWires.Record"),
+	TEXT("Starts or stops recording the wire simulation's inputs for WibblyWires.Replay. Starting resets every wire.\n")
+	TEXT("Optional args: File=<path, defaults to a timestamped file in Saved/WibblyWires>"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FWibblySimulation& Simulation = FWibblySimulation::Get();
+		if (Simulation.IsRecording())
+		{
+			Simulation.StopRecording();
+			GLog->Logf(TEXT("WibblyWires: Stopped recording"));
+			return;
+		}
+
+		FString Path = FPaths::ProjectSavedDir() / TEXT("WibblyWires") / FString::Printf(TEXT("Recording-%s.wibbly"), *FDateTime::Now().ToString());
+		FParse::Value(*FString::Join(Args, TEXT(" ")), TEXT("File="), Path);
+
+		if (Simulation.StartRecording(Path))
+		{
+			GLog->Logf(TEXT("WibblyWires: Recording to %s"), *Path);
+		}
+		else
+		{
+			GLog->Logf(ELogVerbosity::Error, TEXT("WibblyWires: Couldn't start recording to %s"), *Path);
+		}
+	})
+);
+
+FAutoConsoleCommand CVarWibblyWiresReplay(
+	TEXT("WibblyWires.Replay"),
+	TEXT("Replays a recording from WibblyWires.Record and reports how long the simulation took, plus a checksum of the end result.\n")
+	TEXT("Args: File=<path> Runs=<count, default 1>"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		LLM_SCOPE_BYTAG(WibblyWires);
+
+		const FString JoinedArgs = FString::Join(Args, TEXT(" "));
+		FString Path;
+		int32 NumRuns = 1;
+		FParse::Value(*JoinedArgs, TEXT("File="), Path);
+		FParse::Value(*JoinedArgs, TEXT("Runs="), NumRuns);
+
+		FWireReplay Replay;
+		if (!Replay.Load(Path))
+		{
+			GLog->Logf(ELogVerbosity::Error, TEXT("WibblyWires: Couldn't load recording %s"), *Path);
+			return;
+		}
+
+		for (int32 Run = 0; Run < FMath::Max(NumRuns, 1); Run++)
+		{
+			TArray<double> StepSeconds;
+			const uint32 Checksum = Replay.Run(StepSeconds);
+
+			double TotalSeconds = 0.0;
+			for (double Seconds : StepSeconds)
+			{
+				TotalSeconds += Seconds;
+			}
+			StepSeconds.Sort();
+
+			const double P95Seconds = StepSeconds.Num() > 0 ? StepSeconds[FMath::Clamp(FMath::CeilToInt(0.95f * StepSeconds.Num()) - 1, 0, StepSeconds.Num() - 1)] : 0.0;
+			const double MaxSeconds = StepSeconds.Num() > 0 ? StepSeconds.Last() : 0.0;
+			GLog->Logf(TEXT("WibblyWires: Replayed %d steps in %.3f ms (avg %.3f ms, p95 %.3f ms, max %.3f ms), checksum %08x"),
+				Replay.GetNumSteps(), TotalSeconds * 1000.0, StepSeconds.Num() > 0 ? TotalSeconds * 1000.0 / StepSeconds.Num() : 0.0, P95Seconds * 1000.0, MaxSeconds * 1000.0, Checksum);
+		}
+	})
+);
+
+FWibblySimulation* FWibblySimulation::Instance = nullptr;
+
+FWibblySimulation::FWibblySimulation()
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	check(Instance == nullptr);
+	Instance = this;
+
+#if ENGINE_MAJOR_VERSION >= 5
+	TickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FWibblySimulation::Tick));
+#else
+	TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FWibblySimulation::Tick));
+#endif
+}
+
+FWibblySimulation::~FWibblySimulation()
+{
+#if ENGINE_MAJOR_VERSION >= 5
+	FTSTicker::GetCoreTicker().RemoveTicker(TickHandle);
+#else
+	FTicker::GetCoreTicker().RemoveTicker(TickHandle);
+#endif
+
+	WaitForStep();
+
+	Instance = nullptr;
+}
+
+void FWibblySimulation::WaitForStep()
+{
+	// Steps only ever start from Tick, so once this one's done the simulation side is ours until next frame
+	if (StepTask.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(StepTask);
+	}
+}
+
+FWibblySimulation& FWibblySimulation::Get()
+{
+	check(Instance);
+	return *Instance;
+}
+
+FGraphDrawState& FWibblySimulation::FindOrAddGraphDrawState(const FGuid& GraphGuid)
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+	return GraphDrawStates.FindOrAdd(GraphGuid);
+}
+
+const FGraphSnapshot* FWibblySimulation::FindGraphSnapshot(const FGuid& GraphGuid)
+{
+	return Snapshots.Read().Graphs.Find(GraphGuid);
+}
+
+uint64 FWibblySimulation::SubmitInputs(const FGuid& GraphGuid, TArray<FWireInput>&& Inputs, bool bWasHidden)
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	FWireInputBatch Batch;
+	Batch.GraphGuid = GraphGuid;
+	Batch.Serial = NextInputSerial++;
+	Batch.bWasHidden = bWasHidden;
+	Batch.Wires = MoveTemp(Inputs);
+
+	const uint64 Serial = Batch.Serial;
+	PendingInputs.Enqueue(MoveTemp(Batch));
+	return Serial;
+}
+
+bool FWibblySimulation::HasProcessedInput(uint64 Serial)
+{
+	return Snapshots.Read().ProcessedInputSerial >= Serial;
+}
+
+void FWibblySimulation::Reset()
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	// Our side can go straight away, the simulation side gets dropped at the start of its next step
+	GraphDrawStates.Empty();
+	bResetRequested = true;
+}
+
+void FWibblySimulation::DumpStats(FOutputDevice& Ar)
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	WaitForStep();
+
+	TSet<FGuid> GraphGuids;
+	GraphStates.GetKeys(GraphGuids);
+	for (const auto& DrawStatePair : GraphDrawStates)
+	{
+		GraphGuids.Add(DrawStatePair.Key);
+	}
+
+	const FWireSnapshot& Snapshot = Snapshots.Read();
+	auto ToMs = [](double Seconds) { return Seconds * 1000.0; };
+
+	Ar.Logf(TEXT("WibblyWires: %d graphs, quality level %d"), GraphGuids.Num(), (int32)Quality);
+
+	SIZE_T TotalBytes = 0;
+	for (const FGuid& GraphGuid : GraphGuids)
+	{
+		const FGraphState* GraphState = GraphStates.Find(GraphGuid);
+		const FGraphDrawState* GraphDrawState = GraphDrawStates.Find(GraphGuid);
+		const FGraphSnapshot* GraphSnapshot = Snapshot.Graphs.Find(GraphGuid);
+
+		int32 NumWires = 0;
+		int32 NumPreviewConnectors = 0;
+		int32 NumChains = 0;
+		int32 NumPoints = 0;
+		SIZE_T SimulationBytes = 0;
+		if (GraphState)
+		{
+			for (const auto& WirePair : GraphState->Wires)
+			{
+				NumWires++;
+				NumPreviewConnectors += WirePair.Key.IsPreviewConnector() ? 1 : 0;
+			}
+
+			NumChains = GraphState->VerletWires.GetNumChains();
+			NumPoints = GraphState->VerletWires.GetNumPoints();
+			SimulationBytes = GraphState->Wires.GetAllocatedSize() + GraphState->VerletWires.GetAllocatedSize() + GraphState->UpdateTimes.GetAllocatedSize();
+		}
+
+		SIZE_T DrawBytes = 0;
+		if (GraphDrawState)
+		{
+			DrawBytes = GraphDrawState->Wires.GetAllocatedSize() + GraphDrawState->GraphName.GetAllocatedSize() + GraphDrawState->DrawTimes.GetAllocatedSize();
+			for (const auto& DrawCachePair : GraphDrawState->Wires)
+			{
+				DrawBytes += DrawCachePair.Value.CachedPoints.GetAllocatedSize() + DrawCachePair.Value.CachedArcLengths.GetAllocatedSize();
+			}
+		}
+
+		const SIZE_T SnapshotBytes = GraphSnapshot ? GraphSnapshot->CenterPoints.GetAllocatedSize() : 0;
+		TotalBytes += SimulationBytes + DrawBytes + SnapshotBytes;
+
+		Ar.Logf(TEXT("%s (%s)"), GraphDrawState && !GraphDrawState->GraphName.IsEmpty() ? *GraphDrawState->GraphName : TEXT("<unknown graph>"), *GraphGuid.ToString());
+		Ar.Logf(TEXT("    Wires: %d (%d preview connectors), Chains: %d, Points: %d"), NumWires, NumPreviewConnectors, NumChains, NumPoints);
+		Ar.Logf(TEXT("    Memory: %.1f KB simulation, %.1f KB draw caches, %.1f KB snapshot"), SimulationBytes / 1024.0, DrawBytes / 1024.0, SnapshotBytes / 1024.0);
+
+		if (GraphState && GraphState->UpdateTimes.Num() > 0)
+		{
+			const FWibblyTimingHistory& Times = GraphState->UpdateTimes;
+			Ar.Logf(TEXT("    Update: avg %.3f ms, p95 %.3f ms, max %.3f ms over %d steps"), ToMs(Times.GetAverage()), ToMs(Times.GetPercentile(0.95f)), ToMs(Times.GetMax()), Times.Num());
+		}
+
+		if (GraphDrawState && GraphDrawState->DrawTimes.Num() > 0)
+		{
+			const FWibblyTimingHistory& Times = GraphDrawState->DrawTimes;
+			Ar.Logf(TEXT("    Draw: avg %.3f ms, p95 %.3f ms, max %.3f ms over %d draws"), ToMs(Times.GetAverage()), ToMs(Times.GetPercentile(0.95f)), ToMs(Times.GetMax()), Times.Num());
+		}
+	}
+
+	TotalBytes += GraphStates.GetAllocatedSize() + GraphDrawStates.GetAllocatedSize() + Snapshot.Graphs.GetAllocatedSize();
+	Ar.Logf(TEXT("WibblyWires: %.1f KB total"), TotalBytes / 1024.0);
+}
+
+void FWibblySimulation::StepImmediately(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	WaitForStep();
+
+	Step(DeltaTime);
+	Snapshots.SwapReadBuffers();
+}
+
+void FWibblySimulation::RemoveGraph(const FGuid& GraphGuid)
+{
+	// The graph's snapshot goes away with the next publish
+	WaitForStep();
+
+	GraphStates.Remove(GraphGuid);
+	GraphDrawStates.Remove(GraphGuid);
+
+	if (Recorder)
+	{
+		Recorder->EvictGraph(GraphGuid);
+	}
+}
+
+bool FWibblySimulation::StartRecording(const FString& Path)
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	WaitForStep();
+
+	Recorder = FWireRecorder::Create(Path);
+	if (!Recorder)
+	{
+		return false;
+	}
+
+	GraphStates.Empty();
+	GraphDrawStates.Empty();
+	return true;
+}
+
+void FWibblySimulation::StopRecording()
+{
+	WaitForStep();
+	Recorder.Reset();
+}
+
+bool FWibblySimulation::IsRecording() const
+{
+	return Recorder.IsValid();
+}
+
+bool FWibblySimulation::Tick(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	if (!FSlateApplication::IsInitialized())
+	{
+		return true;
+	}
+
+	// Pick up whatever the simulation finished most recently, policies will read from this until next frame
+	if (Snapshots.IsDirty())
+	{
+		Snapshots.SwapReadBuffers();
+	}
+
+	// If the last step is still going then don't wait on it, it just gets a longer step next time
+	PendingDeltaTime += DeltaTime;
+	if (StepTask.IsValid() && !StepTask->IsComplete())
+	{
+		return true;
+	}
+
+	EvictUndrawnGraphs();
+
+	// Nothing new drawn and everything settled means a step wouldn't change anything, so don't even dispatch one
+	if (PendingInputs.IsEmpty() && !bHasMovingWires && !bResetRequested && StepsToFlushEvictions == 0)
+	{
+		PendingDeltaTime = 0.f;
+		return true;
+	}
+	StepsToFlushEvictions = FMath::Max(StepsToFlushEvictions - 1, 0);
+
+	// Clamp our tick rate to 30fps to avoid editor hitches hiding our animations, we'd rather they just pause
+	static const float MaxDeltaTime = 1.f / 30.f;
+	const float StepDeltaTime = FMath::Min(PendingDeltaTime, MaxDeltaTime);
+	PendingDeltaTime = 0.f;
+
+	StepTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this, StepDeltaTime]()
+	{
+		Step(StepDeltaTime);
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+
+	return true;
+}
+
+void FWibblySimulation::EvictUndrawnGraphs()
+{
+	if (EvictAfterSeconds <= 0.f)
+	{
+		return;
+	}
+
+	const double EvictBeforeTime = FPlatformTime::Seconds() - EvictAfterSeconds;
+	for (auto It = GraphDrawStates.CreateIterator(); It; ++It)
+	{
+		if (It.Value().LastDrawnTime < EvictBeforeTime)
+		{
+			// The simulation side goes at the start of the next step
+			PendingEvictions.Enqueue(It.Key());
+			It.RemoveCurrent();
+			StepsToFlushEvictions = 3;
+		}
+	}
+}
+
+void FWibblySimulation::Step(float DeltaTime)
+{
+	// We're on a background thread here, so this needs its own scope
+	LLM_SCOPE_BYTAG(WibblyWires);
+	WIBBLY_SCOPE(STAT_WibblyWires_SimulationStep);
+
+	const double CurrentTime = FPlatformTime::Seconds();
+	const double BudgetSeconds = FMath::Max(FrameBudgetMs, 0.f) / 1000.0;
+	const double DeadlineSeconds = CurrentTime + BudgetSeconds;
+
+	const bool bReset = bResetRequested;
+	if (bReset)
+	{
+		bResetRequested = false;
+		GraphStates.Empty();
+	}
+
+	FGuid EvictedGraphGuid;
+	while (PendingEvictions.Dequeue(EvictedGraphGuid))
+	{
+		GraphStates.Remove(EvictedGraphGuid);
+
+		if (Recorder)
+		{
+			Recorder->EvictGraph(EvictedGraphGuid);
+		}
+	}
+
+	FWireInputBatch Batch;
+	while (PendingInputs.Dequeue(Batch))
+	{
+		GraphStates.FindOrAdd(Batch.GraphGuid).ApplyInputBatch(Batch, CurrentTime);
+		LastProcessedInputSerial = Batch.Serial;
+
+		if (Recorder)
+		{
+			Recorder->AddBatch(MoveTemp(Batch));
+		}
+	}
+
+	NumSteps++;
+	const EWibblySimulationQuality StepQuality = Quality;
+	bool bAnyMoving = false;
+	for (auto& GraphPair : GraphStates)
+	{
+		FGraphState& GraphState = GraphPair.Value;
+		if (GraphState.Step(StepQuality, CurrentTime, DeltaTime, DeadlineSeconds))
+		{
+			GraphState.LastChangedStep = NumSteps;
+		}
+		bAnyMoving |= GraphState.IsMoving();
+	}
+	bHasMovingWires = bAnyMoving;
+
+	// Quality only trades away simulation work, so recording and publishing aren't held against the budget
+	const double SimulationSeconds = FPlatformTime::Seconds() - CurrentTime;
+
+	if (Recorder)
+	{
+		Recorder->FinishStep(CurrentTime, DeltaTime, StepQuality, bReset);
+	}
+
+	PublishSnapshot();
+
+	UpdateQuality(SimulationSeconds, BudgetSeconds);
+}
+
+void FWibblySimulation::UpdateQuality(double SimulationSeconds, double BudgetSeconds)
+{
+	if (SimulationSeconds > BudgetSeconds)
+	{
+		// Over budget, so drop down a level straight away
+		StepsWithHeadroom = 0;
+		if (Quality < EWibblySimulationQuality::StaticWires)
+		{
+			Quality = (EWibblySimulationQuality)((uint8)Quality + 1);
+		}
+	}
+	else if (SimulationSeconds < BudgetSeconds * 0.5)
+	{
+		// Only step back up once we've had plenty of headroom for a while, so we don't flip-flop every frame
+		const int32 StepsBeforeRestoring = 30;
+		if (++StepsWithHeadroom >= StepsBeforeRestoring && Quality > EWibblySimulationQuality::Full)
+		{
+			StepsWithHeadroom = 0;
+			Quality = (EWibblySimulationQuality)((uint8)Quality - 1);
+		}
+	}
+	else
+	{
+		StepsWithHeadroom = 0;
+	}
+}
+
+void FWibblySimulation::PublishSnapshot()
+{
+	// Each buffer keeps its maps between uses, so only throw away graphs that have gone
+	FWireSnapshot& Snapshot = Snapshots.GetWriteBuffer();
+	for (auto It = Snapshot.Graphs.CreateIterator(); It; ++It)
+	{
+		if (!GraphStates.Contains(It.Key()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Then catch up whichever graphs have changed since this buffer was last written, the rest are still current
+	for (const auto& GraphPair : GraphStates)
+	{
+		const FGraphState& GraphState = GraphPair.Value;
+		FGraphSnapshot& GraphSnapshot = Snapshot.Graphs.FindOrAdd(GraphPair.Key);
+		if (GraphSnapshot.LastChangedStep == GraphState.LastChangedStep)
+		{
+			continue;
+		}
+
+		GraphSnapshot.LastChangedStep = GraphState.LastChangedStep;
+		GraphSnapshot.NumMovingWires = GraphState.NumMovingWires;
+		GraphSnapshot.NumVerletChains = GraphState.VerletWires.GetNumChains();
+
+		GraphSnapshot.CenterPoints.Reset();
+		GraphSnapshot.CenterPoints.Reserve(GraphState.Wires.Num());
+		for (const auto& WirePair : GraphState.Wires)
+		{
+			GraphSnapshot.CenterPoints.Add(WirePair.Key, WirePair.Value.CenterPoint);
+		}
+	}
+
+	Snapshot.ProcessedInputSerial = LastProcessedInputSerial;
+	Snapshots.SwapWriteBuffers();
+}
@@ -0,0 +1,107 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "Containers/TripleBuffer.h"
+#include "Runtime/Launch/Resources/Version.h"
+#include "WibblyConnectionDrawingPolicy.h"
+#include "WibblyGraphState.h"
+
+// Results of one simulation step for every graph
+struct FWireSnapshot
+{
+	TMap<FGuid, FGraphSnapshot> Graphs;
+	uint64 ProcessedInputSerial = 0;
+};
+
+class FWireRecorder;
+
+/**
+ * Owns the wire state for every graph and steps all of it once per frame on a background task.
+ *
+ * Drawing policies push the endpoints they draw with through a single-producer queue, and read back the
+ * latest completed snapshot, which is published through a lock-free triple buffer. Paint never waits on
+ * the simulation, if a step is still running when the next frame comes around it just gets more time.
+ * Once every wire has settled and nothing new has been drawn no step is dispatched at all, and a step only
+ * republishes the graphs it changed. Graphs that haven't been drawn for WibblyWires.EvictAfterSeconds are dropped.
+ *
+ * Each step is measured against WibblyWires.FrameBudgetMs, stepping quality down a level whenever it runs over
+ * and back up again once there's been plenty of headroom for a while.
+ */
+class FWibblySimulation
+{
+public:
+	FWibblySimulation();
+	~FWibblySimulation();
+
+	static FWibblySimulation& Get();
+
+	// Game thread only
+	FGraphDrawState& FindOrAddGraphDrawState(const FGuid& GraphGuid);
+	const FGraphSnapshot* FindGraphSnapshot(const FGuid& GraphGuid);
+	uint64 SubmitInputs(const FGuid& GraphGuid, TArray<FWireInput>&& Inputs, bool bWasHidden);
+	bool HasProcessedInput(uint64 Serial);
+	void Reset();
+	// Waits for any running step, then prints counts, memory and timings for every graph
+	void DumpStats(FOutputDevice& Ar);
+
+	// For tools that drive painting themselves: finishes any running step, then steps and publishes on this thread
+	void StepImmediately(float DeltaTime);
+	// Drops everything kept for a graph that's gone for good
+	void RemoveGraph(const FGuid& GraphGuid);
+
+	// Streams every step's inputs to a file that FWireReplay can play back. Wires start over from scratch when recording
+	// starts, draw caches included so every wire gets submitted again, so that the recording fully describes everything
+	// that happens after it.
+	bool StartRecording(const FString& Path);
+	void StopRecording();
+	bool IsRecording() const;
+
+private:
+	bool Tick(float DeltaTime);
+
+	// Simulation task only
+	void Step(float DeltaTime);
+	void UpdateQuality(double SimulationSeconds, double BudgetSeconds);
+	void PublishSnapshot();
+	void WaitForStep();
+
+	// Game thread only
+	void EvictUndrawnGraphs();
+
+	TMap<FGuid, FGraphDrawState> GraphDrawStates;
+	uint64 NextInputSerial = 1;
+	float PendingDeltaTime = 0.f;
+	// Steps still to run after evicting graphs, so each of the snapshot buffers gets republished without them
+	int32 StepsToFlushEvictions = 0;
+	FGraphEventRef StepTask;
+
+	// Simulation task only
+	// For each graph guid, store a map from wire id to wire state
+	TMap<FGuid, FGraphState> GraphStates;
+	uint64 LastProcessedInputSerial = 0;
+	uint64 NumSteps = 0;
+	EWibblySimulationQuality Quality = EWibblySimulationQuality::Full;
+	int32 StepsWithHeadroom = 0;
+	TUniquePtr<FWireRecorder> Recorder;
+
+	// Shared between the two
+	TQueue<FWireInputBatch, EQueueMode::Spsc> PendingInputs;
+	TQueue<FGuid, EQueueMode::Spsc> PendingEvictions;
+	TTripleBuffer<FWireSnapshot> Snapshots;
+	FThreadSafeBool bResetRequested;
+	// Whether any wire was still settling or any chain still falling after the last step
+	FThreadSafeBool bHasMovingWires;
+
+#if ENGINE_MAJOR_VERSION >= 5
+	FTSTicker::FDelegateHandle TickHandle;
+#else
+	FDelegateHandle TickHandle;
+#endif
+
+	static FWibblySimulation* Instance;
+};
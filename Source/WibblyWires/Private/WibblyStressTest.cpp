@@ -0,0 +1,287 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WibblyBenchmarks.h"
+
+#include "BlueprintConnectionDrawingPolicy.h"
+#include "EdGraphSchema_K2.h"
+#include "GraphEditorSettings.h"
+#include "K2Node_Knot.h"
+#include "NodeFactory.h"
+#include "SGraphPin.h"
+#include "Engine/Blueprint.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Kismet2/BlueprintEditorUtils.h"
+#include "Kismet2/KismetEditorUtilities.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Widgets/SWindow.h"
+#include "WibblyConnectionDrawingPolicy.h"
+#include "WibblySimulation.h"
+
+namespace WibblyStressTest
+{
+	using namespace WibblyBenchmarks;
+
+	// Lets us turn bubbles on for every wire, which otherwise only happens while debugging
+	template <typename PolicyType>
+	class TStressPolicy : public PolicyType
+	{
+	public:
+		TStressPolicy(const FSlateRect& InClippingRect, FSlateWindowElementList& InDrawElements, UEdGraph* InGraphObj, bool bInForceBubbles)
+			: PolicyType(0, 1, 1.f, InClippingRect, InDrawElements, InGraphObj)
+			, bForceBubbles(bInForceBubbles)
+		{
+		}
+
+		virtual void DetermineWiringStyle(UEdGraphPin* OutputPin, UEdGraphPin* InputPin, FConnectionParams& Params) override
+		{
+			PolicyType::DetermineWiringStyle(OutputPin, InputPin, Params);
+			Params.bDrawBubbles |= bForceBubbles;
+		}
+
+	private:
+		bool bForceBubbles;
+	};
+
+	struct FPinLayout
+	{
+		TSharedRef<SWidget> Widget;
+		FVector2D Position;
+	};
+
+	// A Blueprint event graph full of reroute nodes laid out on a grid, randomly linked together, with a pin widget for each pin
+	struct FSyntheticGraph
+	{
+		UBlueprint* Blueprint = nullptr;
+		UEdGraph* Graph = nullptr;
+		TArray<FPinLayout> Pins;
+		TMap<TSharedRef<SWidget>, FArrangedWidget> PinGeometries;
+
+		FSyntheticGraph(int32 NumNodes, int32 NumLinks)
+		{
+			const FName BlueprintName = MakeUniqueObjectName(GetTransientPackage(), UBlueprint::StaticClass(), TEXT("WibblyWiresStress"));
+			Blueprint = FKismetEditorUtilities::CreateBlueprint(AActor::StaticClass(), GetTransientPackage(), BlueprintName, BPTYPE_Normal, UBlueprint::StaticClass(), UBlueprintGeneratedClass::StaticClass());
+			Blueprint->AddToRoot();
+			Graph = FBlueprintEditorUtils::FindEventGraph(Blueprint);
+
+			const int32 NumColumns = FMath::Max(FMath::CeilToInt(FMath::Sqrt((float)NumNodes)), 1);
+			const FVector2D NodeSpacing(250.f, 120.f);
+			const float PinSpacing = 100.f;
+
+			TArray<UK2Node_Knot*> Knots;
+			for (int32 i = 0; i < NumNodes; i++)
+			{
+				FGraphNodeCreator<UK2Node_Knot> NodeCreator(*Graph);
+				UK2Node_Knot* Knot = NodeCreator.CreateNode(false);
+				Knot->NodePosX = (i % NumColumns) * NodeSpacing.X;
+				Knot->NodePosY = (i / NumColumns) * NodeSpacing.Y;
+				NodeCreator.Finalize();
+				Knots.Add(Knot);
+
+				const FVector2D NodePosition(Knot->NodePosX, Knot->NodePosY);
+				AddPin(Knot->GetInputPin(), NodePosition);
+				AddPin(Knot->GetOutputPin(), NodePosition + FVector2D(PinSpacing, 0.f));
+			}
+
+			FRandomStream Random(NumNodes * 31 + NumLinks);
+			for (int32 i = 0; i < NumLinks && NumNodes > 1; i++)
+			{
+				const int32 From = Random.RandHelper(NumNodes);
+				const int32 To = (From + 1 + Random.RandHelper(NumNodes - 1)) % NumNodes;
+				Knots[From]->GetOutputPin()->MakeLinkTo(Knots[To]->GetInputPin());
+			}
+
+			SetFrame(0, false);
+		}
+
+		~FSyntheticGraph()
+		{
+			FWibblySimulation::Get().RemoveGraph(Graph->GraphGuid);
+			Blueprint->RemoveFromRoot();
+		}
+
+		// Moves half the pins around a little each frame, so wires never get to settle when bWiggle is set
+		void SetFrame(int32 Frame, bool bWiggle)
+		{
+			for (int32 i = 0; i < Pins.Num(); i++)
+			{
+				const bool bWigglePin = bWiggle && (i / 2) % 2 == 0;
+				const FVector2D Offset = bWigglePin ? FVector2D(0.f, FMath::Sin(Frame * 0.3f + i) * 30.f) : FVector2D::ZeroVector;
+				const FGeometry Geometry = FGeometry::MakeRoot(FVector2D(16.f, 16.f), FSlateLayoutTransform(Pins[i].Position + Offset));
+				PinGeometries.Add(Pins[i].Widget, FArrangedWidget(Pins[i].Widget, Geometry));
+			}
+		}
+
+	private:
+		void AddPin(UEdGraphPin* Pin, const FVector2D& Position)
+		{
+			TSharedPtr<SGraphPin> PinWidget = FNodeFactory::CreatePinWidget(Pin);
+			if (PinWidget.IsValid())
+			{
+				Pins.Add({ PinWidget.ToSharedRef(), Position });
+			}
+		}
+	};
+
+	struct FConfig
+	{
+		const TCHAR* Name;
+		bool bSprings;
+		bool bHover;
+		bool bBubbles;
+	};
+
+	template <typename PolicyType>
+	static FResult RunPaintPasses(const TCHAR* PolicyName, const FConfig& Config, FSyntheticGraph& SyntheticGraph, int32 NumLinks, int32 NumFrames)
+	{
+		const TSharedRef<SWindow> Window = SNew(SWindow);
+		const FSlateRect ClippingRect(0.f, 0.f, 1920.f, 1080.f);
+		const FVector2D MousePosition = ClippingRect.GetCenter();
+		FArrangedChildren ArrangedNodes(EVisibility::Visible);
+
+		UGraphEditorSettings* Settings = GetMutableDefault<UGraphEditorSettings>();
+		const bool bPreviousTreatSplinesLikePins = Settings->bTreatSplinesLikePins;
+		Settings->bTreatSplinesLikePins = Config.bHover;
+
+		auto PaintFrame = [&]()
+		{
+			// Everything a real paint would do with the policy, but nothing else
+			FSlateWindowElementList DrawElements(Window);
+			const double StartTime = FPlatformTime::Seconds();
+			{
+				TStressPolicy<PolicyType> Policy(ClippingRect, DrawElements, SyntheticGraph.Graph, Config.bBubbles);
+				if (Config.bHover)
+				{
+					Policy.SetMousePosition(MousePosition);
+				}
+				Policy.Draw(SyntheticGraph.PinGeometries, ArrangedNodes);
+			}
+			return FPlatformTime::Seconds() - StartTime;
+		};
+
+		auto PrepareFrame = [&](int32 Frame)
+		{
+			SyntheticGraph.SetFrame(Frame, Config.bSprings);
+			if (Config.bSprings)
+			{
+				FWibblySimulation::Get().StepImmediately(1.f / 60.f);
+			}
+		};
+
+		// Warm up so the wibbly policy has its draw caches and simulation state, like it would in an open graph.
+		// The first paint only queues up the wires, so step whatever the config to get them into a snapshot before timing.
+		PrepareFrame(0);
+		PaintFrame();
+		FWibblySimulation::Get().StepImmediately(1.f / 60.f);
+		PaintFrame();
+
+		TArray<double> FrameSeconds;
+		double NumAllocations = 0.0;
+		{
+			FScopedAllocationCounter AllocationCounter;
+			for (int32 Frame = 1; Frame <= NumFrames; Frame++)
+			{
+				PrepareFrame(Frame);
+
+				// Setting up each frame isn't part of the paint, so only count what happens while painting
+				const double AllocationsBefore = AllocationCounter.GetNumAllocations();
+				FrameSeconds.Add(PaintFrame());
+				NumAllocations += AllocationCounter.GetNumAllocations() - AllocationsBefore;
+			}
+
+			if (AllocationCounter.GetNumAllocations() < 0.0)
+			{
+				NumAllocations = -1.0;
+			}
+		}
+
+		Settings->bTreatSplinesLikePins = bPreviousTreatSplinesLikePins;
+
+		double TotalSeconds = 0.0;
+		for (double Seconds : FrameSeconds)
+		{
+			TotalSeconds += Seconds;
+		}
+		FrameSeconds.Sort();
+
+		FResult Result;
+		Result.Name = FString::Printf(TEXT("Paint.%s.%s"), PolicyName, Config.Name);
+		Result.Size = NumLinks;
+		Result.NumOps = NumFrames;
+		Result.NsPerOp = TotalSeconds * 1e9 / NumFrames;
+		Result.ItemsPerSecond = TotalSeconds > 0.0 ? (double)NumLinks * NumFrames / TotalSeconds : 0.0;
+		Result.AllocationsPerOp = NumAllocations >= 0.0 ? NumAllocations / NumFrames : -1.0;
+		Result.P50NsPerOp = FrameSeconds[FrameSeconds.Num() / 2] * 1e9;
+		Result.P95NsPerOp = FrameSeconds[FMath::Clamp(FMath::CeilToInt(0.95f * FrameSeconds.Num()) - 1, 0, FrameSeconds.Num() - 1)] * 1e9;
+		Result.MaxNsPerOp = FrameSeconds.Last() * 1e9;
+		return Result;
+	}
+
+	static int32 RunStress(const FString& Args)
+	{
+		LLM_SCOPE_BYTAG(WibblyWires);
+
+		const FReportOptions Options = ParseReportOptions(Args, TEXT("Stress"));
+
+		int32 NumNodes = 1000;
+		int32 NumLinks = 2000;
+		int32 NumFrames = 60;
+		FParse::Value(*Args, TEXT("Nodes="), NumNodes);
+		FParse::Value(*Args, TEXT("Links="), NumLinks);
+		FParse::Value(*Args, TEXT("Frames="), NumFrames);
+		NumFrames = FMath::Max(NumFrames, 1);
+
+		const FConfig Configs[] =
+		{
+			{ TEXT("Static"), false, false, false },
+			{ TEXT("Springs"), true, false, false },
+			{ TEXT("Hover"), false, true, false },
+			{ TEXT("Bubbles"), false, false, true },
+			{ TEXT("All"), true, true, true },
+		};
+
+		TArray<FResult> Results;
+		{
+			FSyntheticGraph SyntheticGraph(NumNodes, NumLinks);
+			for (const FConfig& Config : Configs)
+			{
+				Results.Add(RunPaintPasses<FKismetConnectionDrawingPolicy>(TEXT("Kismet"), Config, SyntheticGraph, NumLinks, NumFrames));
+				Results.Add(RunPaintPasses<FWibblyConnectionDrawingPolicy>(TEXT("Wibbly"), Config, SyntheticGraph, NumLinks, NumFrames));
+			}
+		}
+
+		return ReportResults(Results, Options, *GLog);
+	}
+}
+
+FAutoConsoleCommand CVarWibblyWiresStress(
+	TEXT("WibblyWires.Stress"),
+	TEXT("Builds a synthetic Blueprint graph and times full connection paint passes for the wibbly and stock policies, with springs, hover and bubbles toggled.\n")
+	TEXT("Optional args: Nodes=<count, default 1000> Links=<count, default 2000> Frames=<count, default 60> Out=<path> Baseline=<path> Threshold=<fraction, default 0.1>"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		WibblyStressTest::RunStress(FString::Join(Args, TEXT(" ")));
+	})
+);
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// The same run as a test, so a regression against Baseline= fails it. Args are read from -WibblyWiresStress="..." on the
+// command line, like WibblyWires.Perf.Benchmark.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWibblyWiresStressTest, "WibblyWires.Perf.Stress", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FWibblyWiresStressTest::RunTest(const FString& Parameters)
+{
+	FString Args;
+	FParse::Value(FCommandLine::Get(), TEXT("WibblyWiresStress="), Args, false);
+
+	const int32 NumRegressions = WibblyStressTest::RunStress(Args);
+	TestEqual(TEXT("Regressions against the baseline"), NumRegressions, 0);
+	return NumRegressions == 0;
+}
+
+#endif
@@ -0,0 +1,17 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Runtime/Launch/Resources/Version.h"
+
+// Everything wires and chains simulate and draw with is single precision, since that's all Slate works in anyway.
+// Before UE 5.1 FVector2D is already float, so it's used as is. Anything coming from or going back to Slate is converted
+// explicitly at the boundary.
+#if ENGINE_MAJOR_VERSION >= 5 && ENGINE_MINOR_VERSION >= 1
+typedef FVector2f FVectorType;
+typedef FBox2f FBoxType;
+#else
+typedef FVector2D FVectorType;
+typedef FBox2D FBoxType;
+#endif
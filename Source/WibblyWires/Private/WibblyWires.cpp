@@ -4,24 +4,57 @@
 
 #include "EdGraphUtilities.h"
 #include "WibblyConnectionDrawingPolicy.h"
+#include "WibblySimulation.h"
+#include "WibblyWiresStats.h"
 
 #define LOCTEXT_NAMESPACE "FWibblyWiresModule"
 
+DEFINE_STAT(STAT_WibblyWires_CreatePolicy);
+DEFINE_STAT(STAT_WibblyWires_DrawConnections);
+DEFINE_STAT(STAT_WibblyWires_PrepareWires);
+DEFINE_STAT(STAT_WibblyWires_HoverTest);
+DEFINE_STAT(STAT_WibblyWires_EmitWires);
+DEFINE_STAT(STAT_WibblyWires_DrawBubbles);
+DEFINE_STAT(STAT_WibblyWires_SimulationStep);
+DEFINE_STAT(STAT_WibblyWires_UpdateWires);
+DEFINE_STAT(STAT_WibblyWires_UpdateVerletChains);
+
+DEFINE_STAT(STAT_WibblyWires_WiresDrawn);
+DEFINE_STAT(STAT_WibblyWires_WiresCulled);
+DEFINE_STAT(STAT_WibblyWires_WiresTessellated);
+DEFINE_STAT(STAT_WibblyWires_HoverCandidates);
+DEFINE_STAT(STAT_WibblyWires_WiresSimulated);
+DEFINE_STAT(STAT_WibblyWires_ChainsAlive);
+DEFINE_STAT(STAT_WibblyWires_PointsSimulated);
+
+UE_TRACE_CHANNEL_DEFINE(WibblyWiresChannel);
+
+LLM_DEFINE_TAG(WibblyWires);
+
 static TSharedPtr<FWibblyConnectionDrawingPolicy::Factory> GraphConnectionFactory;
+static TUniquePtr<FWibblySimulation> WireSimulation;
 
 void FWibblyWiresModule::StartupModule()
 {
+	LLM_SCOPE_BYTAG(WibblyWires);
+
+	WireSimulation = MakeUnique<FWibblySimulation>();
+
 	GraphConnectionFactory = MakeShared<FWibblyConnectionDrawingPolicy::Factory>();
 	FEdGraphUtilities::RegisterVisualPinConnectionFactory(GraphConnectionFactory);
 }
 
 void FWibblyWiresModule::ShutdownModule()
 {
+	LLM_SCOPE_BYTAG(WibblyWires);
+
 	if (GraphConnectionFactory.IsValid())
 	{
 		FEdGraphUtilities::UnregisterVisualPinConnectionFactory(GraphConnectionFactory);
 		GraphConnectionFactory = nullptr;
 	}
+
+	WireSimulation.Reset();
 }
 
 #undef LOCTEXT_NAMESPACE
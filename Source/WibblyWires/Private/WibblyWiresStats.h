@@ -0,0 +1,112 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+// Shows up under `stat WibblyWires`
+DECLARE_STATS_GROUP(TEXT("WibblyWires"), STATGROUP_WibblyWires, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create Policy"), STAT_WibblyWires_CreatePolicy, STATGROUP_WibblyWires, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Draw Connections"), STAT_WibblyWires_DrawConnections, STATGROUP_WibblyWires, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Prepare Wires"), STAT_WibblyWires_PrepareWires, STATGROUP_WibblyWires, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Hover Test"), STAT_WibblyWires_HoverTest, STATGROUP_WibblyWires, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Emit Wires"), STAT_WibblyWires_EmitWires, STATGROUP_WibblyWires, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Draw Bubbles"), STAT_WibblyWires_DrawBubbles, STATGROUP_WibblyWires, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Simulation Step"), STAT_WibblyWires_SimulationStep, STATGROUP_WibblyWires, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Wires"), STAT_WibblyWires_UpdateWires, STATGROUP_WibblyWires, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Verlet Chains"), STAT_WibblyWires_UpdateVerletChains, STATGROUP_WibblyWires, );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Wires Drawn"), STAT_WibblyWires_WiresDrawn, STATGROUP_WibblyWires, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Wires Culled"), STAT_WibblyWires_WiresCulled, STATGROUP_WibblyWires, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Wires Re-tessellated"), STAT_WibblyWires_WiresTessellated, STATGROUP_WibblyWires, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hover Candidates"), STAT_WibblyWires_HoverCandidates, STATGROUP_WibblyWires, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Wires Simulated"), STAT_WibblyWires_WiresSimulated, STATGROUP_WibblyWires, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Chains Alive"), STAT_WibblyWires_ChainsAlive, STATGROUP_WibblyWires, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Points Simulated"), STAT_WibblyWires_PointsSimulated, STATGROUP_WibblyWires, );
+
+// Everything the plugin allocates is tagged with this, so it shows up as its own line in `stat LLM` and memory insights.
+// Allocation happens on the game thread and the simulation task, so each entry point we get called through opens a scope.
+LLM_DECLARE_TAG(WibblyWires);
+
+// Lets Insights captures include or exclude just our scopes with -trace=cpu,WibblyWires
+UE_TRACE_CHANNEL_EXTERN(WibblyWiresChannel);
+
+// Times a scope for both `stat WibblyWires` and Insights
+#define WIBBLY_SCOPE(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, WibblyWiresChannel)
+
+// Rolling window of recent timings for one graph, so reports can show spikes as well as the typical cost
+struct FWibblyTimingHistory
+{
+	static const int32 MaxSamples = 120;
+
+	void AddSample(double Seconds)
+	{
+		if (Samples.Num() < MaxSamples)
+		{
+			Samples.Add(Seconds);
+		}
+		else
+		{
+			Samples[NextSample] = Seconds;
+		}
+
+		NextSample = (NextSample + 1) % MaxSamples;
+	}
+
+	int32 Num() const
+	{
+		return Samples.Num();
+	}
+
+	double GetAverage() const
+	{
+		double Total = 0.0;
+		for (double Sample : Samples)
+		{
+			Total += Sample;
+		}
+
+		return Samples.Num() > 0 ? Total / Samples.Num() : 0.0;
+	}
+
+	double GetMax() const
+	{
+		double Max = 0.0;
+		for (double Sample : Samples)
+		{
+			Max = FMath::Max(Max, Sample);
+		}
+
+		return Max;
+	}
+
+	// Only used for reports, so sorting a copy each time is fine
+	double GetPercentile(float Percentile) const
+	{
+		if (Samples.Num() == 0)
+		{
+			return 0.0;
+		}
+
+		TArray<double> Sorted = Samples;
+		Sorted.Sort();
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+		return Sorted[Index];
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Samples.GetAllocatedSize();
+	}
+
+private:
+	TArray<double> Samples;
+	int32 NextSample = 0;
+};
@@ -0,0 +1,122 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WibblyTypes.h"
+
+// A wire's hermite spline stored as polynomial coefficients, so evaluating lots of points along it is just a Horner step each
+struct FWireCurve
+{
+	FVectorType A; // t^3
+	FVectorType B; // t^2
+	FVectorType C; // t
+	FVectorType D; // 1
+
+	FWireCurve(const FVectorType& P0, const FVectorType& P0Tangent, const FVectorType& P1, const FVectorType& P1Tangent)
+	{
+		// Same basis as FMath::CubicInterp, just collected by power of t
+		A = 2.f * P0 + P0Tangent - 2.f * P1 + P1Tangent;
+		B = -3.f * P0 - 2.f * P0Tangent + 3.f * P1 - P1Tangent;
+		C = P0Tangent;
+		D = P0;
+	}
+
+	FORCEINLINE FVectorType Eval(float Alpha) const
+	{
+		return ((A * Alpha + B) * Alpha + C) * Alpha + D;
+	}
+
+	// Position and exact first derivative at Alpha, sharing the Horner terms
+	FORCEINLINE void EvalWithDerivative(float Alpha, FVectorType& OutPosition, FVectorType& OutDerivative) const
+	{
+		const FVectorType ATPlusB = A * Alpha + B;
+		OutPosition = (ATPlusB * Alpha + C) * Alpha + D;
+		OutDerivative = ((A * (3.f * Alpha) + 2.f * B) * Alpha) + C;
+	}
+
+	// Closest approach to Point along a NumSteps segment approximation of the curve, returning its distance squared
+	float FindClosestPoint(const FVectorType& Point, int32 NumSteps, FVectorType& OutClosestPoint) const
+	{
+		float ClosestDistanceSquared = FLT_MAX;
+		OutClosestPoint = FVectorType(ForceInit);
+
+		const float StepInterval = 1.0f / (float)NumSteps;
+		FVectorType Point1 = D;
+		for (int32 Step = 1; Step <= NumSteps; Step++)
+		{
+			const FVectorType Point2 = Eval(Step * StepInterval);
+
+			const FVectorType ClosestPointToSegment = ClosestPointOnSegment(Point, Point1, Point2);
+			const float DistanceSquared = (Point - ClosestPointToSegment).SizeSquared();
+
+			if (DistanceSquared < ClosestDistanceSquared)
+			{
+				ClosestDistanceSquared = DistanceSquared;
+				OutClosestPoint = ClosestPointToSegment;
+			}
+
+			Point1 = Point2;
+		}
+
+		return ClosestDistanceSquared;
+	}
+
+	// Same as FMath::ClosestPointOnSegment2D, which only takes FVector2D
+	static FORCEINLINE FVectorType ClosestPointOnSegment(const FVectorType& Point, const FVectorType& StartPoint, const FVectorType& EndPoint)
+	{
+		const FVectorType Segment = EndPoint - StartPoint;
+		const float SegmentSizeSquared = Segment.SizeSquared();
+		if (SegmentSizeSquared <= 0.f)
+		{
+			return StartPoint;
+		}
+
+		const float Alpha = FMath::Clamp(((Point - StartPoint) | Segment) / SegmentSizeSquared, 0.f, 1.f);
+		return StartPoint + Segment * Alpha;
+	}
+
+	void EvalMany(TArrayView<const float> Alphas, TArray<FVectorType>& OutPositions) const
+	{
+		OutPositions.SetNumUninitialized(Alphas.Num());
+		FVectorType* RESTRICT Out = OutPositions.GetData();
+
+		for (int32 i = 0; i < Alphas.Num(); i++)
+		{
+			Out[i] = Eval(Alphas[i]);
+		}
+	}
+};
+
+// Maps distances along a curve back to alphas, given the curve's arc length at evenly spaced alphas (as FWireDrawCache keeps).
+// Since the inputs are sorted we can walk the table once instead of binary searching it for every sample.
+inline void EvalSortedArcLengths(TArrayView<const float> ArcLengths, TArrayView<const float> SortedInputs, TArrayView<float> OutAlphas)
+{
+	check(OutAlphas.Num() == SortedInputs.Num());
+
+	const int32 NumSegments = ArcLengths.Num() - 1;
+	if (NumSegments <= 0)
+	{
+		for (float& Alpha : OutAlphas)
+		{
+			Alpha = 0.f;
+		}
+		return;
+	}
+
+	const float Step = 1.f / NumSegments;
+	int32 Segment = 0;
+	for (int32 i = 0; i < SortedInputs.Num(); i++)
+	{
+		const float Input = SortedInputs[i];
+
+		while (Segment < NumSegments - 1 && ArcLengths[Segment + 1] <= Input)
+		{
+			Segment++;
+		}
+
+		const float SegmentLength = ArcLengths[Segment + 1] - ArcLengths[Segment];
+		const float SegmentAlpha = SegmentLength > 0.f ? FMath::Clamp((Input - ArcLengths[Segment]) / SegmentLength, 0.f, 1.f) : 0.f;
+		OutAlphas[i] = (Segment + SegmentAlpha) * Step;
+	}
+}
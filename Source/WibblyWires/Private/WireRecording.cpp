@@ -0,0 +1,251 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WireRecording.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Crc.h"
+
+namespace WireRecording
+{
+	static const uint32 Magic = 0x50525757; // "WWRP"
+	static const uint32 Version = 4;
+
+	// Written out component by component so the format doesn't depend on which vector type FVectorType is
+	static void SerializePoint(FArchive& Ar, FVectorType& Point)
+	{
+		float X = Point.X;
+		float Y = Point.Y;
+		Ar << X;
+		Ar << Y;
+		Point = FVectorType(X, Y);
+	}
+}
+
+TUniquePtr<FWireRecorder> FWireRecorder::Create(const FString& Path)
+{
+	FArchive* Writer = IFileManager::Get().CreateFileWriter(*Path);
+	if (!Writer)
+	{
+		return nullptr;
+	}
+
+	uint32 Magic = WireRecording::Magic;
+	uint32 Version = WireRecording::Version;
+	*Writer << Magic;
+	*Writer << Version;
+
+	return TUniquePtr<FWireRecorder>(new FWireRecorder(Writer));
+}
+
+FWireRecorder::FWireRecorder(FArchive* InWriter)
+	: Writer(InWriter)
+{
+}
+
+FWireRecorder::~FWireRecorder()
+{
+	Writer->Close();
+}
+
+uint32 FWireRecorder::GetPinKey(const FGuid& PinId)
+{
+	if (!PinId.IsValid())
+	{
+		return 0;
+	}
+
+	if (const uint32* ExistingKey = PinKeys.Find(PinId))
+	{
+		return *ExistingKey;
+	}
+
+	return PinKeys.Add(PinId, PinKeys.Num() + 1);
+}
+
+void FWireRecorder::AddBatch(FWireInputBatch&& Batch)
+{
+	PendingStep.Batches.Add(MoveTemp(Batch));
+}
+
+void FWireRecorder::EvictGraph(const FGuid& GraphGuid)
+{
+	PendingStep.EvictedGraphs.Add(GraphGuid);
+}
+
+void FWireRecorder::FinishStep(double CurrentTime, float DeltaTime, EWibblySimulationQuality Quality, bool bReset)
+{
+	FArchive& Ar = *Writer;
+
+	uint8 QualityByte = (uint8)Quality;
+	uint8 ResetByte = bReset ? 1 : 0;
+	int32 NumEvicted = PendingStep.EvictedGraphs.Num();
+	int32 NumBatches = PendingStep.Batches.Num();
+	Ar << CurrentTime;
+	Ar << DeltaTime;
+	Ar << QualityByte;
+	Ar << ResetByte;
+	Ar << NumEvicted;
+	for (FGuid& GraphGuid : PendingStep.EvictedGraphs)
+	{
+		Ar << GraphGuid;
+	}
+	Ar << NumBatches;
+
+	for (FWireInputBatch& Batch : PendingStep.Batches)
+	{
+		int32 NumWires = Batch.Wires.Num();
+		uint8 HiddenByte = Batch.bWasHidden ? 1 : 0;
+		Ar << Batch.GraphGuid;
+		Ar << HiddenByte;
+		Ar << NumWires;
+
+		for (FWireInput& Input : Batch.Wires)
+		{
+			uint32 StartKey = GetPinKey(Input.WireId.StartPinId);
+			uint32 EndKey = GetPinKey(Input.WireId.EndPinId);
+			uint32 WireHash = GetTypeHash(Input.WireId);
+			Ar << StartKey;
+			Ar << EndKey;
+			Ar << WireHash;
+			WireRecording::SerializePoint(Ar, Input.StartPoint);
+			WireRecording::SerializePoint(Ar, Input.EndPoint);
+		}
+	}
+
+	PendingStep.Batches.Reset();
+	PendingStep.EvictedGraphs.Reset();
+}
+
+bool FWireReplay::Load(const FString& Path)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Path));
+	if (!Reader)
+	{
+		return false;
+	}
+
+	FArchive& Ar = *Reader;
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Ar << Magic;
+	Ar << Version;
+	if (Magic != WireRecording::Magic || Version != WireRecording::Version)
+	{
+		return false;
+	}
+
+	Steps.Reset();
+	while (!Ar.AtEnd() && !Ar.IsError())
+	{
+		FWireRecordedStep& Step = Steps.AddDefaulted_GetRef();
+
+		uint8 QualityByte = 0;
+		uint8 ResetByte = 0;
+		int32 NumEvicted = 0;
+		int32 NumBatches = 0;
+		Ar << Step.CurrentTime;
+		Ar << Step.DeltaTime;
+		Ar << QualityByte;
+		Ar << ResetByte;
+		Ar << NumEvicted;
+		if (NumEvicted < 0 || Ar.IsError())
+		{
+			return false;
+		}
+
+		Step.EvictedGraphs.SetNum(NumEvicted);
+		for (FGuid& GraphGuid : Step.EvictedGraphs)
+		{
+			Ar << GraphGuid;
+		}
+		Ar << NumBatches;
+		Step.Quality = (EWibblySimulationQuality)FMath::Min(QualityByte, (uint8)EWibblySimulationQuality::StaticWires);
+		Step.bReset = ResetByte != 0;
+
+		for (int32 BatchIndex = 0; BatchIndex < NumBatches && !Ar.IsError(); BatchIndex++)
+		{
+			FWireInputBatch& Batch = Step.Batches.AddDefaulted_GetRef();
+
+			int32 NumWires = 0;
+			uint8 HiddenByte = 0;
+			Ar << Batch.GraphGuid;
+			Ar << HiddenByte;
+			Ar << NumWires;
+			Batch.bWasHidden = HiddenByte != 0;
+			if (NumWires < 0 || Ar.IsError())
+			{
+				return false;
+			}
+
+			Batch.Wires.Reserve(NumWires);
+			for (int32 WireIndex = 0; WireIndex < NumWires; WireIndex++)
+			{
+				uint32 StartKey = 0;
+				uint32 EndKey = 0;
+				uint32 WireHash = 0;
+				FVectorType StartPoint;
+				FVectorType EndPoint;
+				Ar << StartKey;
+				Ar << EndKey;
+				Ar << WireHash;
+				WireRecording::SerializePoint(Ar, StartPoint);
+				WireRecording::SerializePoint(Ar, EndPoint);
+				Batch.Wires.Emplace(FWireId::MakeReplayId(StartKey, EndKey, WireHash), StartPoint, EndPoint);
+			}
+		}
+	}
+
+	return !Ar.IsError();
+}
+
+uint32 FWireReplay::Run(TArray<double>& OutStepSeconds) const
+{
+	TMap<FGuid, FGraphState> GraphStates;
+
+	OutStepSeconds.Reset(Steps.Num());
+	for (const FWireRecordedStep& Step : Steps)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+
+		if (Step.bReset)
+		{
+			GraphStates.Empty();
+		}
+
+		for (const FGuid& GraphGuid : Step.EvictedGraphs)
+		{
+			GraphStates.Remove(GraphGuid);
+		}
+
+		for (const FWireInputBatch& Batch : Step.Batches)
+		{
+			GraphStates.FindOrAdd(Batch.GraphGuid).ApplyInputBatch(Batch, Step.CurrentTime);
+		}
+
+		for (auto& GraphPair : GraphStates)
+		{
+			GraphPair.Value.Step(Step.Quality, Step.CurrentTime, Step.DeltaTime, DBL_MAX);
+		}
+
+		OutStepSeconds.Add(FPlatformTime::Seconds() - StartTime);
+	}
+
+	return CalcChecksum(GraphStates);
+}
+
+uint32 FWireReplay::CalcChecksum(const TMap<FGuid, FGraphState>& GraphStates)
+{
+	uint32 Checksum = 0;
+	for (const auto& GraphPair : GraphStates)
+	{
+		for (const auto& WirePair : GraphPair.Value.Wires)
+		{
+			const FVectorType& CenterPoint = WirePair.Value.CenterPoint;
+			Checksum = HashCombine(Checksum, GetTypeHash(WirePair.Key));
+			Checksum = FCrc::MemCrc32(&CenterPoint, sizeof(CenterPoint), Checksum);
+		}
+	}
+
+	return Checksum;
+}
@@ -0,0 +1,71 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WibblyGraphState.h"
+
+// One simulation step as it was recorded
+struct FWireRecordedStep
+{
+	double CurrentTime = 0.0;
+	float DeltaTime = 0.f;
+	EWibblySimulationQuality Quality = EWibblySimulationQuality::Full;
+	// Whether every graph was thrown away (WibblyWires.ResetWireStates) before this step
+	bool bReset = false;
+	// Graphs dropped after the reset, either for going undrawn too long or being removed outright
+	TArray<FGuid> EvictedGraphs;
+	TArray<FWireInputBatch> Batches;
+};
+
+/**
+ * Writes each simulation step's inputs out to a compact binary file, from the simulation task.
+ *
+ * Pins are swapped for small integer keys the first time they're seen and endpoints are stored as floats, so a step costs
+ * a handful of bytes per drawn wire. Each wire's hash goes along with its keys, since that's what its variance comes from.
+ */
+class FWireRecorder
+{
+public:
+	static TUniquePtr<FWireRecorder> Create(const FString& Path);
+	~FWireRecorder();
+
+	// Batches are collected as the step applies them, then the whole step is written out once it's done
+	void AddBatch(FWireInputBatch&& Batch);
+	void EvictGraph(const FGuid& GraphGuid);
+	void FinishStep(double CurrentTime, float DeltaTime, EWibblySimulationQuality Quality, bool bReset);
+
+private:
+	explicit FWireRecorder(FArchive* InWriter);
+	uint32 GetPinKey(const FGuid& PinId);
+
+	TUniquePtr<FArchive> Writer;
+	TMap<FGuid, uint32> PinKeys;
+	FWireRecordedStep PendingStep;
+};
+
+/**
+ * Plays a recording back against graph states of its own, through the same per-graph code the live simulation uses.
+ * Like the recorder it only needs Core, so recordings can also be replayed without an editor by the standalone
+ * WibblyReplay tool (see Tests/WibblyReplay.cpp).
+ */
+class FWireReplay
+{
+public:
+	bool Load(const FString& Path);
+
+	// Steps fresh graph states through the whole recording, returning a checksum of where every wire ended up.
+	// Time-sliced steps get unlimited time, since the original deadlines depended on how fast the recording machine was.
+	uint32 Run(TArray<double>& OutStepSeconds) const;
+
+	// Where every wire in GraphStates is, folded into one number. Only comparable between runs of the same build.
+	static uint32 CalcChecksum(const TMap<FGuid, FGraphState>& GraphStates);
+
+	int32 GetNumSteps() const
+	{
+		return Steps.Num();
+	}
+
+private:
+	TArray<FWireRecordedStep> Steps;
+};
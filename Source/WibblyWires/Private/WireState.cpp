@@ -0,0 +1,242 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WireState.h"
+
+#include "HAL/IConsoleManager.h"
+
+static int32 BounceWires = 0;
+FAutoConsoleVariableRef CVarBounceWires(
+	TEXT("WibblyWires.BounceWires"),
+	BounceWires,
+	TEXT("Whether wires have some bounce when they extend too far")
+);
+
+static float RopeLengthHangMultiplier = 1.f;
+FAutoConsoleVariableRef CVarWireLength(
+	TEXT("WibblyWires.WireLength"),
+	RopeLengthHangMultiplier,
+	TEXT("How much extra length should wires have")
+);
+
+static float WireRestTolerance = 0.05f;
+FAutoConsoleVariableRef CVarWireRestTolerance(
+	TEXT("WibblyWires.RestTolerance"),
+	WireRestTolerance,
+	TEXT("How close to still (in pixels, and pixels per second for velocities) a wire needs to be before it's treated as resting and reuses its cached shape")
+);
+
+float WireCatchUpThreshold = 0.1f;
+FAutoConsoleVariableRef CVarWireCatchUpThreshold(
+	TEXT("WibblyWires.CatchUpThreshold"),
+	WireCatchUpThreshold,
+	TEXT("How many seconds a wire can go unsimulated before it's jumped forward analytically rather than carrying on frame by frame")
+);
+
+static float WireSnapThreshold = 2.f;
+FAutoConsoleVariableRef CVarWireSnapThreshold(
+	TEXT("WibblyWires.SnapThreshold"),
+	WireSnapThreshold,
+	TEXT("How many seconds a wire can go unsimulated before it just snaps to its resting shape")
+);
+
+namespace WireState
+{
+	// Scrambles a wire's hash into an independent value in [Min, Max) for each Salt
+	static float HashToRange(uint32 WireHash, uint32 Salt, float Min, float Max)
+	{
+		// Murmur3's finalizer, which spreads every input bit across the whole output
+		uint32 Mixed = WireHash ^ (Salt * 0x9E3779B9u);
+		Mixed ^= Mixed >> 16;
+		Mixed *= 0x85EBCA6Bu;
+		Mixed ^= Mixed >> 13;
+		Mixed *= 0xC2B2AE35u;
+		Mixed ^= Mixed >> 16;
+
+		const float Alpha = (float)(Mixed >> 8) / (float)(1u << 24);
+		return FMath::Lerp(Min, Max, Alpha);
+	}
+}
+
+FWireParams FWireParams::FromHash(uint32 WireHash, bool bIsPreviewConnector)
+{
+	const float DefaultStiffness = 100.f;
+	const float DefaultDampeningRatio = 0.4f;
+
+	float StiffnessVariance = WireState::HashToRange(WireHash, 1, 0.3f, 1.5f);
+	float DampeningVariance = WireState::HashToRange(WireHash, 2, 0.7f, 1.2f);
+
+	FWireParams Params;
+	Params.SpringStiffness = DefaultStiffness * StiffnessVariance + (bIsPreviewConnector ? 0.3f : 0.f);
+	Params.SpringDampeningRatio = FMath::Clamp(DefaultDampeningRatio * DampeningVariance, 0.3f, 0.9f);
+	Params.DesiredSlackMultiplier = 1.3f + WireState::HashToRange(WireHash, 3, 0.f, 0.3f);
+	return Params;
+}
+
+FWireState::FWireState(FVectorType StartPoint, FVectorType EndPoint, const FWireParams& Params)
+{
+	TargetStartPoint = StartPoint;
+	TargetEndPoint = EndPoint;
+
+	// Start off a little off from the desired rope length so there's an initial bounce
+	LerpedRopeLength = (EndPoint - StartPoint).Size() * Params.DesiredSlackMultiplier * 1.1f;
+
+	// Snap to the desired center point
+	CenterPoint = CalculateDesiredRopeCenterPoint();
+	CenterVelocity = FVectorType::ZeroVector;
+}
+
+FVectorType FWireState::CalculateDesiredCenterPointWithRopeLengthDelta(FVectorType StartPoint, FVectorType EndPoint, float RopeLengthDelta)
+{
+	FVectorType Center = CalculateDesiredCenterPoint(StartPoint, EndPoint);
+	Center.Y += RopeLengthDelta * RopeLengthHangMultiplier;
+	return Center;
+}
+
+FVectorType FWireState::CalculateDesiredCenterPoint(FVectorType StartPoint, FVectorType EndPoint)
+{
+	if (StartPoint.X > EndPoint.X)
+	{
+		Swap(StartPoint, EndPoint);
+	}
+
+	FVectorType Delta = EndPoint - StartPoint;
+	FVectorType Direction = Delta.GetSafeNormal();
+	FVectorType UpDirection(0.f, 1.f);
+	float DotWithUp = Direction | UpDirection;
+	DotWithUp = FMath::Pow(FMath::Abs(DotWithUp), 2.f) * FMath::Sign(DotWithUp);
+	float NormalizedDotWithUp = DotWithUp * 0.5f + 0.5f;
+	float CenterX = FMath::Lerp(StartPoint.X, EndPoint.X, NormalizedDotWithUp);
+	// This won't be quite the same as deriving a CenterY from the real CenterX, but we'll see how it looks cause avoids some trig
+	FVectorType Center = FMath::Lerp(StartPoint, EndPoint, NormalizedDotWithUp);
+	return Center;
+}
+
+FVectorType FWireState::CalculateDesiredRopeCenterPoint() const
+{
+	// Ensure start point is always the left-most point so we can make some assumptions with our math
+	FVectorType StartPoint = TargetStartPoint;
+	FVectorType EndPoint = TargetEndPoint;
+	if (StartPoint.X > EndPoint.X)
+	{
+		Swap(StartPoint, EndPoint);
+	}
+
+	const float TightRopeLength = (EndPoint - StartPoint).Size();
+	return CalculateDesiredCenterPointWithRopeLengthDelta(StartPoint, EndPoint, LerpedRopeLength - TightRopeLength);
+}
+
+void FWireState::SetTargets(const FVectorType& StartPoint, const FVectorType& EndPoint)
+{
+	bTargetsMoved |= StartPoint != TargetStartPoint || EndPoint != TargetEndPoint;
+	TargetStartPoint = StartPoint;
+	TargetEndPoint = EndPoint;
+}
+
+void FWireState::AdvanceSpring(const FVectorType& DesiredRopeCenterPoint, float ElapsedTime, const FWireParams& Params)
+{
+	const float AngularFrequency = FMath::Sqrt(Params.SpringStiffness);
+	const float DampedFrequency = AngularFrequency * FMath::Sqrt(FMath::Max(1.f - Params.SpringDampeningRatio * Params.SpringDampeningRatio, 0.f));
+	if (DampedFrequency < KINDA_SMALL_NUMBER)
+	{
+		CenterPoint = DesiredRopeCenterPoint;
+		CenterVelocity = FVectorType::ZeroVector;
+		return;
+	}
+
+	// Closed form underdamped spring, treating the target as sitting still for ElapsedTime:
+	// x(t) = e^(-zwt) * (x0 cos(wd t) + (v0 + zw x0) / wd * sin(wd t))
+	// This is exact for any step size, so per-frame updates and catching up share it.
+	const FVectorType Offset = CenterPoint - DesiredRopeCenterPoint;
+	const float Decay = Params.SpringDampeningRatio * AngularFrequency;
+	const float Envelope = FMath::Exp(-Decay * ElapsedTime);
+	float SinWdt, CosWdt;
+	FMath::SinCos(&SinWdt, &CosWdt, DampedFrequency * ElapsedTime);
+
+	const FVectorType SinCoefficient = (CenterVelocity + Decay * Offset) / DampedFrequency;
+	const FVectorType NewOffset = Envelope * (Offset * CosWdt + SinCoefficient * SinWdt);
+	const FVectorType NewVelocity = Envelope * ((SinCoefficient * DampedFrequency - Decay * Offset) * CosWdt - (Offset * DampedFrequency + Decay * SinCoefficient) * SinWdt);
+
+	CenterPoint = DesiredRopeCenterPoint + NewOffset;
+	CenterVelocity = NewVelocity;
+}
+
+FVectorType FWireState::Update(float DeltaTime, const FWireParams& Params)
+{
+	const float TightRopeLength = (TargetEndPoint - TargetStartPoint).Size();
+	const float DesiredRopeLength = TightRopeLength * Params.DesiredSlackMultiplier;
+	LerpedRopeLength = FMath::Max(TightRopeLength, FMath::Lerp(LerpedRopeLength, DesiredRopeLength, DeltaTime * 20.f));
+
+	const FVectorType DesiredRopeCenterPoint = CalculateDesiredRopeCenterPoint();
+	AdvanceSpring(DesiredRopeCenterPoint, DeltaTime, Params);
+
+	if (BounceWires && CenterPoint.Y > DesiredRopeCenterPoint.Y && CenterVelocity.Y > 0.1f)
+	{
+		CenterVelocity.Y = FMath::Abs(CenterVelocity.Y) * -0.9f;
+	}
+
+	return CenterPoint;
+}
+
+void FWireState::CatchUp(float ElapsedTime, const FWireParams& Params)
+{
+	const float TightRopeLength = (TargetEndPoint - TargetStartPoint).Size();
+	const float DesiredRopeLength = TightRopeLength * Params.DesiredSlackMultiplier;
+
+	// Update() lerps by DeltaTime * 20 each frame, which is exponential decay at a rate of 20 in the limit
+	LerpedRopeLength = FMath::Max(TightRopeLength, DesiredRopeLength + (LerpedRopeLength - DesiredRopeLength) * FMath::Exp(-20.f * ElapsedTime));
+	const FVectorType DesiredRopeCenterPoint = CalculateDesiredRopeCenterPoint();
+
+	if (ElapsedTime >= WireSnapThreshold)
+	{
+		CenterPoint = DesiredRopeCenterPoint;
+		CenterVelocity = FVectorType::ZeroVector;
+		return;
+	}
+
+	AdvanceSpring(DesiredRopeCenterPoint, ElapsedTime, Params);
+}
+
+bool FWireState::Simulate(double CurrentTime, float DeltaTime, const FWireParams& Params)
+{
+	// If we haven't simulated this wire for a while (off-screen, or its graph wasn't open) then jump it forward in one go.
+	// A wire that had settled isn't simulated while it's left alone, so it just carries on from rest.
+	const float TimeSinceSimulated = (float)(CurrentTime - LastSimulatedTime);
+	LastSimulatedTime = CurrentTime;
+	if (TimeSinceSimulated > WireCatchUpThreshold && !bIsSettled)
+	{
+		// The catch up already covers this frame, stepping again would run the wire DeltaTime ahead
+		CatchUp(TimeSinceSimulated, Params);
+		bTargetsMoved = false;
+		bIsSettled = IsAtRest(Params);
+		return !bIsSettled;
+	}
+
+	if (!bTargetsMoved && (bIsSettled || IsAtRest(Params)))
+	{
+		bIsSettled = true;
+		return false;
+	}
+
+	bTargetsMoved = false;
+	Update(DeltaTime, Params);
+	bIsSettled = IsAtRest(Params);
+	return !bIsSettled;
+}
+
+void FWireState::SnapToRest(double CurrentTime, const FWireParams& Params)
+{
+	// Catching up by longer than the snap threshold jumps straight to the resting shape
+	CatchUp(FMath::Max(WireSnapThreshold, 1.f), Params);
+	bTargetsMoved = false;
+	bIsSettled = true;
+	LastSimulatedTime = CurrentTime;
+}
+
+bool FWireState::IsAtRest(const FWireParams& Params) const
+{
+	const float ToleranceSquared = WireRestTolerance * WireRestTolerance;
+	const float DesiredRopeLength = (TargetEndPoint - TargetStartPoint).Size() * Params.DesiredSlackMultiplier;
+	return FMath::Abs(LerpedRopeLength - DesiredRopeLength) < WireRestTolerance
+		&& FVectorType::DistSquared(CenterPoint, CalculateDesiredRopeCenterPoint()) < ToleranceSquared
+		&& CenterVelocity.SizeSquared() < ToleranceSquared;
+}
@@ -0,0 +1,63 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WibblyTypes.h"
+
+extern float WireCatchUpThreshold;
+
+// How a wire springs and hangs. Nothing here is stored per wire, it's derived from the wire's id whenever it's needed,
+// so a wire behaves the same way every session and every benchmark run.
+struct FWireParams
+{
+	float SpringStiffness;
+	float SpringDampeningRatio;
+	float DesiredSlackMultiplier;
+
+	static FWireParams FromHash(uint32 WireHash, bool bIsPreviewConnector);
+};
+
+// Simulation state for a single wire, only ever touched by the simulation task.
+// Like the chains in Verlet.h this only needs Core, so it knows nothing about Slate or the editor.
+// This is only what actually changes frame to frame, everything else is recomputed from FWireParams and the endpoints.
+struct FWireState
+{
+	FVectorType CenterPoint;
+	FVectorType CenterVelocity;
+	float LerpedRopeLength;
+	double LastSimulatedTime = 0.0;
+
+	// Latest endpoints the wire was drawn with
+	FVectorType TargetStartPoint;
+	FVectorType TargetEndPoint;
+	// Whether the targets changed since the wire was last updated
+	bool bTargetsMoved = false;
+	bool bWasDrawn = false;
+	// Whether the wire had come to rest when it was last simulated. Resting wires look the same however long they go
+	// unsimulated, so they have nothing to catch up on.
+	bool bIsSettled = false;
+
+	FWireState() = default;
+	FWireState(FVectorType StartPoint, FVectorType EndPoint, const FWireParams& Params);
+
+	static FVectorType CalculateDesiredCenterPointWithRopeLengthDelta(FVectorType StartPoint, FVectorType EndPoint, float RopeLengthDelta);
+	static FVectorType CalculateDesiredCenterPoint(FVectorType StartPoint, FVectorType EndPoint);
+
+	void SetTargets(const FVectorType& StartPoint, const FVectorType& EndPoint);
+	// Steps the wire towards its targets by DeltaTime, returning the new center point
+	FVectorType Update(float DeltaTime, const FWireParams& Params);
+	// Steps the wire towards its latest target endpoints, returning whether it's still moving
+	bool Simulate(double CurrentTime, float DeltaTime, const FWireParams& Params);
+	// Jumps the wire forward by ElapsedTime in closed form (or snaps it to rest if it's been long enough)
+	void CatchUp(float ElapsedTime, const FWireParams& Params);
+	// Puts the wire straight into its resting shape for its latest endpoints
+	void SnapToRest(double CurrentTime, const FWireParams& Params);
+	bool IsAtRest(const FWireParams& Params) const;
+
+private:
+	// Where the center point is being pulled to for the current targets and rope length
+	FVectorType CalculateDesiredRopeCenterPoint() const;
+	// Moves the center point and its velocity along the spring by ElapsedTime, with the target held still
+	void AdvanceSpring(const FVectorType& DesiredRopeCenterPoint, float ElapsedTime, const FWireParams& Params);
+};
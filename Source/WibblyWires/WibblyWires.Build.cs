@@ -25,7 +25,8 @@ public class WibblyWires : ModuleRules
 			"SlateCore",
 			"GraphEditor",
 			"UnrealEd",
-			"BlueprintGraph"
+			"BlueprintGraph",
+			"Json"
 		});
 
 		DynamicallyLoadedModuleNames.AddRange(new string[] { });
@@ -0,0 +1,665 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+// A small stand-in for the parts of Core that the simulation code uses, so it can be built and tested without an engine.
+// Only what the plugin actually calls is here, with the same names and semantics as the real thing. Anything that doesn't
+// affect results (stats, LLM, trace) compiles away to nothing.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef int64_t int64;
+typedef size_t SIZE_T;
+typedef uintptr_t UPTRINT;
+typedef char TCHAR;
+typedef char ANSICHAR;
+
+#define TEXT(x) x
+#define FORCEINLINE inline
+#define FORCENOINLINE __attribute__((noinline))
+#define RESTRICT __restrict
+
+#define check(Expr) do { if (!(Expr)) { std::fprintf(stderr, "Check failed: %s (%s:%d)\n", #Expr, __FILE__, __LINE__); std::abort(); } } while (0)
+#define checkSlow(Expr) check(Expr)
+#define ensure(Expr) (!!(Expr))
+
+#define SMALL_NUMBER (1.e-8f)
+#define KINDA_SMALL_NUMBER (1.e-4f)
+#define BIG_NUMBER (3.4e+38f)
+#define PI (3.1415926535897932f)
+
+enum { INDEX_NONE = -1 };
+
+enum EForceInit
+{
+	ForceInit,
+	ForceInitToZero,
+};
+
+template <typename T>
+FORCEINLINE typename std::remove_reference<T>::type&& MoveTemp(T&& Obj)
+{
+	return static_cast<typename std::remove_reference<T>::type&&>(Obj);
+}
+
+template <typename T>
+FORCEINLINE void Swap(T& A, T& B)
+{
+	T Temp = MoveTemp(A);
+	A = MoveTemp(B);
+	B = MoveTemp(Temp);
+}
+
+struct FPlatformTime
+{
+	static double Seconds()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+};
+
+// Hashing
+
+inline uint32 HashCombine(uint32 A, uint32 C)
+{
+	// Same mix as Core's, so hashes built from it come out the same
+	uint32 B = 0x9e3779b9;
+	A += B;
+
+	A -= B; A -= C; A ^= (C >> 13);
+	B -= C; B -= A; B ^= (A << 8);
+	C -= A; C -= B; C ^= (B >> 13);
+	A -= B; A -= C; A ^= (C >> 12);
+	B -= C; B -= A; B ^= (A << 16);
+	C -= A; C -= B; C ^= (B >> 5);
+	A -= B; A -= C; A ^= (C >> 3);
+	B -= C; B -= A; B ^= (A << 10);
+	C -= A; C -= B; C ^= (B >> 15);
+
+	return C;
+}
+
+FORCEINLINE uint32 GetTypeHash(uint32 Value) { return Value; }
+FORCEINLINE uint32 GetTypeHash(int32 Value) { return (uint32)Value; }
+FORCEINLINE uint32 GetTypeHash(uint64 Value) { return (uint32)Value + ((uint32)(Value >> 32) * 23); }
+
+template <typename T>
+FORCEINLINE uint32 GetTypeHash(const T* Pointer)
+{
+	return GetTypeHash((uint64)(UPTRINT)Pointer);
+}
+
+// Math
+
+struct FMath
+{
+	template <typename T> static constexpr FORCEINLINE T Min(T A, T B) { return A < B ? A : B; }
+	template <typename T> static constexpr FORCEINLINE T Max(T A, T B) { return A > B ? A : B; }
+	template <typename T> static constexpr FORCEINLINE T Clamp(T X, T Min, T Max) { return X < Min ? Min : X < Max ? X : Max; }
+	template <typename T> static constexpr FORCEINLINE T Abs(T A) { return A < (T)0 ? -A : A; }
+	template <typename T> static constexpr FORCEINLINE T Sign(T A) { return A > (T)0 ? (T)1 : A < (T)0 ? (T)-1 : (T)0; }
+	template <typename T> static constexpr FORCEINLINE T Square(T A) { return A * A; }
+
+	template <typename T, typename U>
+	static FORCEINLINE T Lerp(const T& A, const T& B, const U& Alpha)
+	{
+		return (T)(A + Alpha * (B - A));
+	}
+
+	static FORCEINLINE float Sqrt(float Value) { return std::sqrt(Value); }
+	static FORCEINLINE double Sqrt(double Value) { return std::sqrt(Value); }
+	static FORCEINLINE float InvSqrt(float Value) { return 1.f / std::sqrt(Value); }
+	// The hardware estimate plus one Newton-Raphson step where there is one, as Core does, so tests see the same precision
+	static FORCEINLINE float InvSqrtEst(float Value)
+	{
+#if defined(__SSE__) || defined(_M_X64)
+		const float Estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(Value)));
+		return Estimate * (1.5f - 0.5f * Value * Estimate * Estimate);
+#else
+		return InvSqrt(Value);
+#endif
+	}
+	static FORCEINLINE float Pow(float A, float B) { return std::pow(A, B); }
+	static FORCEINLINE float Exp(float Value) { return std::exp(Value); }
+	static FORCEINLINE float Sin(float Value) { return std::sin(Value); }
+	static FORCEINLINE float Cos(float Value) { return std::cos(Value); }
+	static FORCEINLINE bool IsNaN(float Value) { return std::isnan(Value); }
+	static FORCEINLINE bool IsFinite(float Value) { return std::isfinite(Value); }
+	static FORCEINLINE bool IsNearlyEqual(float A, float B, float Tolerance = SMALL_NUMBER) { return Abs(A - B) <= Tolerance; }
+	static FORCEINLINE int32 CeilToInt(float Value) { return (int32)std::ceil(Value); }
+	static FORCEINLINE int32 FloorToInt(float Value) { return (int32)std::floor(Value); }
+	static FORCEINLINE int32 RoundToInt(float Value) { return (int32)std::floor(Value + 0.5f); }
+
+	static FORCEINLINE void SinCos(float* ScalarSin, float* ScalarCos, float Value)
+	{
+		*ScalarSin = std::sin(Value);
+		*ScalarCos = std::cos(Value);
+	}
+};
+
+// Vectors and boxes, only the single precision 2D ones
+
+struct FVector2f
+{
+	float X;
+	float Y;
+
+	static const FVector2f ZeroVector;
+	static const FVector2f UnitVector;
+
+	FVector2f() : X(0.f), Y(0.f) {}
+	FVector2f(float InX, float InY) : X(InX), Y(InY) {}
+	explicit FVector2f(EForceInit) : X(0.f), Y(0.f) {}
+
+	FORCEINLINE FVector2f operator+(const FVector2f& V) const { return FVector2f(X + V.X, Y + V.Y); }
+	FORCEINLINE FVector2f operator-(const FVector2f& V) const { return FVector2f(X - V.X, Y - V.Y); }
+	FORCEINLINE FVector2f operator*(const FVector2f& V) const { return FVector2f(X * V.X, Y * V.Y); }
+	FORCEINLINE FVector2f operator/(const FVector2f& V) const { return FVector2f(X / V.X, Y / V.Y); }
+	FORCEINLINE FVector2f operator*(float Scale) const { return FVector2f(X * Scale, Y * Scale); }
+	FORCEINLINE FVector2f operator/(float Scale) const { const float RScale = 1.f / Scale; return FVector2f(X * RScale, Y * RScale); }
+	FORCEINLINE FVector2f operator-() const { return FVector2f(-X, -Y); }
+	FORCEINLINE float operator|(const FVector2f& V) const { return X * V.X + Y * V.Y; }
+	FORCEINLINE float operator^(const FVector2f& V) const { return X * V.Y - Y * V.X; }
+
+	FORCEINLINE FVector2f& operator+=(const FVector2f& V) { X += V.X; Y += V.Y; return *this; }
+	FORCEINLINE FVector2f& operator-=(const FVector2f& V) { X -= V.X; Y -= V.Y; return *this; }
+	FORCEINLINE FVector2f& operator*=(float Scale) { X *= Scale; Y *= Scale; return *this; }
+	FORCEINLINE FVector2f& operator/=(float Scale) { const float RScale = 1.f / Scale; X *= RScale; Y *= RScale; return *this; }
+
+	FORCEINLINE bool operator==(const FVector2f& V) const { return X == V.X && Y == V.Y; }
+	FORCEINLINE bool operator!=(const FVector2f& V) const { return X != V.X || Y != V.Y; }
+
+	FORCEINLINE float Size() const { return std::sqrt(X * X + Y * Y); }
+	FORCEINLINE float SizeSquared() const { return X * X + Y * Y; }
+
+	FORCEINLINE FVector2f GetSafeNormal(float Tolerance = SMALL_NUMBER) const
+	{
+		const float SquareSum = X * X + Y * Y;
+		if (SquareSum > Tolerance)
+		{
+			const float Scale = FMath::InvSqrt(SquareSum);
+			return FVector2f(X * Scale, Y * Scale);
+		}
+		return FVector2f(0.f, 0.f);
+	}
+
+	FORCEINLINE bool Equals(const FVector2f& V, float Tolerance = KINDA_SMALL_NUMBER) const
+	{
+		return FMath::Abs(X - V.X) <= Tolerance && FMath::Abs(Y - V.Y) <= Tolerance;
+	}
+
+	FORCEINLINE bool ContainsNaN() const
+	{
+		return !FMath::IsFinite(X) || !FMath::IsFinite(Y);
+	}
+
+	static FORCEINLINE float DistSquared(const FVector2f& V1, const FVector2f& V2) { return (V2 - V1).SizeSquared(); }
+	static FORCEINLINE float Distance(const FVector2f& V1, const FVector2f& V2) { return (V2 - V1).Size(); }
+};
+
+inline const FVector2f FVector2f::ZeroVector(0.f, 0.f);
+inline const FVector2f FVector2f::UnitVector(1.f, 1.f);
+
+FORCEINLINE FVector2f operator*(float Scale, const FVector2f& V)
+{
+	return V * Scale;
+}
+
+struct FBox2f
+{
+	FVector2f Min;
+	FVector2f Max;
+	bool bIsValid;
+
+	FBox2f() : bIsValid(false) {}
+	explicit FBox2f(EForceInit) : Min(0.f, 0.f), Max(0.f, 0.f), bIsValid(false) {}
+	FBox2f(const FVector2f& InMin, const FVector2f& InMax) : Min(InMin), Max(InMax), bIsValid(true) {}
+
+	FBox2f& operator+=(const FVector2f& Other)
+	{
+		if (bIsValid)
+		{
+			Min.X = FMath::Min(Min.X, Other.X);
+			Min.Y = FMath::Min(Min.Y, Other.Y);
+			Max.X = FMath::Max(Max.X, Other.X);
+			Max.Y = FMath::Max(Max.Y, Other.Y);
+		}
+		else
+		{
+			Min = Max = Other;
+			bIsValid = true;
+		}
+		return *this;
+	}
+
+	FVector2f GetCenter() const { return (Min + Max) * 0.5f; }
+	FVector2f GetSize() const { return Max - Min; }
+};
+
+struct FLinearColor
+{
+	float R;
+	float G;
+	float B;
+	float A;
+
+	static const FLinearColor White;
+	static const FLinearColor Black;
+
+	FLinearColor() : R(0.f), G(0.f), B(0.f), A(0.f) {}
+	FLinearColor(float InR, float InG, float InB, float InA = 1.f) : R(InR), G(InG), B(InB), A(InA) {}
+};
+
+inline const FLinearColor FLinearColor::White(1.f, 1.f, 1.f);
+inline const FLinearColor FLinearColor::Black(0.f, 0.f, 0.f);
+
+struct FGuid
+{
+	uint32 A;
+	uint32 B;
+	uint32 C;
+	uint32 D;
+
+	FGuid() : A(0), B(0), C(0), D(0) {}
+	FGuid(uint32 InA, uint32 InB, uint32 InC, uint32 InD) : A(InA), B(InB), C(InC), D(InD) {}
+
+	bool IsValid() const { return (A | B | C | D) != 0; }
+	void Invalidate() { A = B = C = D = 0; }
+
+	friend bool operator==(const FGuid& X, const FGuid& Y) { return ((X.A ^ Y.A) | (X.B ^ Y.B) | (X.C ^ Y.C) | (X.D ^ Y.D)) == 0; }
+	friend bool operator!=(const FGuid& X, const FGuid& Y) { return !(X == Y); }
+
+	friend uint32 GetTypeHash(const FGuid& Guid)
+	{
+		return HashCombine(HashCombine(Guid.A, Guid.B), HashCombine(Guid.C, Guid.D));
+	}
+};
+
+// Containers
+
+template <typename KeyType, typename ValueType>
+struct TPair
+{
+	KeyType Key;
+	ValueType Value;
+
+	TPair(const KeyType& InKey, ValueType&& InValue) : Key(InKey), Value(MoveTemp(InValue)) {}
+	TPair(const KeyType& InKey, const ValueType& InValue) : Key(InKey), Value(InValue) {}
+};
+
+// Allocator policies only change where the memory comes from, which makes no difference here
+struct FDefaultAllocator {};
+
+template <typename T, typename AllocatorType = FDefaultAllocator>
+class TArray
+{
+public:
+	typedef T ElementType;
+
+	TArray() = default;
+	TArray(std::initializer_list<T> InitList) : Data(InitList) {}
+	TArray(const T* Ptr, int32 Count) : Data(Ptr, Ptr + Count) {}
+
+	template <typename OtherAllocator>
+	TArray(const TArray<T, OtherAllocator>& Other) : Data(Other.begin(), Other.end()) {}
+
+	FORCEINLINE int32 Num() const { return (int32)Data.size(); }
+	FORCEINLINE bool IsEmpty() const { return Data.empty(); }
+	FORCEINLINE bool IsValidIndex(int32 Index) const { return Index >= 0 && Index < Num(); }
+	FORCEINLINE T* GetData() { return Data.data(); }
+	FORCEINLINE const T* GetData() const { return Data.data(); }
+	FORCEINLINE SIZE_T GetAllocatedSize() const { return Data.capacity() * sizeof(T); }
+
+	FORCEINLINE T& operator[](int32 Index) { checkSlow(IsValidIndex(Index)); return Data[Index]; }
+	FORCEINLINE const T& operator[](int32 Index) const { checkSlow(IsValidIndex(Index)); return Data[Index]; }
+	FORCEINLINE T& Last(int32 IndexFromTheEnd = 0) { return (*this)[Num() - IndexFromTheEnd - 1]; }
+	FORCEINLINE const T& Last(int32 IndexFromTheEnd = 0) const { return (*this)[Num() - IndexFromTheEnd - 1]; }
+
+	int32 Add(const T& Item) { Data.push_back(Item); return Num() - 1; }
+	int32 Add(T&& Item) { Data.push_back(MoveTemp(Item)); return Num() - 1; }
+	T& Add_GetRef(const T& Item) { Data.push_back(Item); return Data.back(); }
+	T& Add_GetRef(T&& Item) { Data.push_back(MoveTemp(Item)); return Data.back(); }
+	int32 AddDefaulted() { Data.emplace_back(); return Num() - 1; }
+	T& AddDefaulted_GetRef() { Data.emplace_back(); return Data.back(); }
+	int32 AddZeroed(int32 Count = 1) { const int32 Index = Num(); Data.resize(Data.size() + Count, T()); return Index; }
+	int32 AddUnique(const T& Item) { const int32 Index = Find(Item); return Index != INDEX_NONE ? Index : Add(Item); }
+
+	template <typename... ArgTypes>
+	int32 Emplace(ArgTypes&&... Args) { Data.emplace_back(std::forward<ArgTypes>(Args)...); return Num() - 1; }
+
+	template <typename... ArgTypes>
+	T& Emplace_GetRef(ArgTypes&&... Args) { Data.emplace_back(std::forward<ArgTypes>(Args)...); return Data.back(); }
+
+	void Append(const TArray& Other) { Data.insert(Data.end(), Other.Data.begin(), Other.Data.end()); }
+
+	void SetNum(int32 NewNum) { Data.resize(NewNum); }
+	void SetNumZeroed(int32 NewNum) { Data.assign(NewNum, T()); }
+	void SetNumUninitialized(int32 NewNum) { Data.resize(NewNum); }
+	void Reserve(int32 Count) { Data.reserve(Count); }
+	void Reset(int32 NewSize = 0) { Data.clear(); Data.reserve(NewSize); }
+	void Empty(int32 Slack = 0) { std::vector<T>().swap(Data); Data.reserve(Slack); }
+
+	void RemoveAt(int32 Index, int32 Count = 1) { Data.erase(Data.begin() + Index, Data.begin() + Index + Count); }
+
+	void RemoveAtSwap(int32 Index)
+	{
+		if (Index != Num() - 1)
+		{
+			Data[Index] = MoveTemp(Data.back());
+		}
+		Data.pop_back();
+	}
+
+	template <typename PredicateType>
+	int32 RemoveAllSwap(const PredicateType& Predicate)
+	{
+		int32 NumRemoved = 0;
+		for (int32 Index = 0; Index < Num();)
+		{
+			if (Predicate(Data[Index]))
+			{
+				RemoveAtSwap(Index);
+				NumRemoved++;
+			}
+			else
+			{
+				Index++;
+			}
+		}
+		return NumRemoved;
+	}
+
+	template <typename PredicateType>
+	int32 RemoveAll(const PredicateType& Predicate)
+	{
+		const int32 OldNum = Num();
+		Data.erase(std::remove_if(Data.begin(), Data.end(), Predicate), Data.end());
+		return OldNum - Num();
+	}
+
+	int32 Find(const T& Item) const
+	{
+		const auto It = std::find(Data.begin(), Data.end(), Item);
+		return It != Data.end() ? (int32)(It - Data.begin()) : INDEX_NONE;
+	}
+
+	bool Contains(const T& Item) const { return Find(Item) != INDEX_NONE; }
+
+	void Sort() { std::sort(Data.begin(), Data.end()); }
+
+	template <typename PredicateType>
+	void Sort(const PredicateType& Predicate) { std::sort(Data.begin(), Data.end(), Predicate); }
+
+	auto begin() { return Data.begin(); }
+	auto end() { return Data.end(); }
+	auto begin() const { return Data.begin(); }
+	auto end() const { return Data.end(); }
+
+private:
+	std::vector<T> Data;
+};
+
+template <typename T>
+class TArrayView
+{
+public:
+	TArrayView() : DataPtr(nullptr), ArrayNum(0) {}
+	TArrayView(T* InData, int32 InNum) : DataPtr(InData), ArrayNum(InNum) {}
+
+	template <typename OtherType, typename AllocatorType>
+	TArrayView(TArray<OtherType, AllocatorType>& Other) : DataPtr(Other.GetData()), ArrayNum(Other.Num()) {}
+
+	template <typename OtherType, typename AllocatorType>
+	TArrayView(const TArray<OtherType, AllocatorType>& Other) : DataPtr(Other.GetData()), ArrayNum(Other.Num()) {}
+
+	template <typename OtherType>
+	TArrayView(const TArrayView<OtherType>& Other) : DataPtr(Other.GetData()), ArrayNum(Other.Num()) {}
+
+	TArrayView(std::initializer_list<typename std::remove_const<T>::type> InitList) : DataPtr(InitList.begin()), ArrayNum((int32)InitList.size()) {}
+
+	FORCEINLINE int32 Num() const { return ArrayNum; }
+	FORCEINLINE T* GetData() const { return DataPtr; }
+	FORCEINLINE T& operator[](int32 Index) const { checkSlow(Index >= 0 && Index < ArrayNum); return DataPtr[Index]; }
+	FORCEINLINE T& Last() const { return (*this)[ArrayNum - 1]; }
+
+	T* begin() const { return DataPtr; }
+	T* end() const { return DataPtr + ArrayNum; }
+
+private:
+	T* DataPtr;
+	int32 ArrayNum;
+};
+
+template <typename T>
+FORCEINLINE TArrayView<T> MakeArrayView(T* Pointer, int32 Size)
+{
+	return TArrayView<T>(Pointer, Size);
+}
+
+template <typename T, typename AllocatorType>
+FORCEINLINE TArrayView<T> MakeArrayView(TArray<T, AllocatorType>& Other)
+{
+	return TArrayView<T>(Other);
+}
+
+// Keeps its pairs densely packed in insertion order (until something's removed), with a side index for lookups.
+// Like the real one, adding or removing can move existing values around.
+template <typename KeyType, typename ValueType>
+class TMap
+{
+public:
+	typedef TPair<KeyType, ValueType> ElementType;
+
+	FORCEINLINE int32 Num() const { return Pairs.Num(); }
+	FORCEINLINE bool IsEmpty() const { return Pairs.IsEmpty(); }
+
+	ValueType& Add(const KeyType& Key, ValueType&& Value)
+	{
+		if (ValueType* Existing = Find(Key))
+		{
+			*Existing = MoveTemp(Value);
+			return *Existing;
+		}
+		Index.emplace(Key, Pairs.Num());
+		return Pairs.Emplace_GetRef(Key, MoveTemp(Value)).Value;
+	}
+
+	ValueType& Add(const KeyType& Key, const ValueType& Value)
+	{
+		return Add(Key, ValueType(Value));
+	}
+
+	ValueType& FindOrAdd(const KeyType& Key)
+	{
+		if (ValueType* Existing = Find(Key))
+		{
+			return *Existing;
+		}
+		return Add(Key, ValueType());
+	}
+
+	ValueType* Find(const KeyType& Key)
+	{
+		const auto It = Index.find(Key);
+		return It != Index.end() ? &Pairs[It->second].Value : nullptr;
+	}
+
+	const ValueType* Find(const KeyType& Key) const
+	{
+		const auto It = Index.find(Key);
+		return It != Index.end() ? &Pairs[It->second].Value : nullptr;
+	}
+
+	const ValueType& FindChecked(const KeyType& Key) const
+	{
+		const ValueType* Value = Find(Key);
+		check(Value);
+		return *Value;
+	}
+
+	bool Contains(const KeyType& Key) const
+	{
+		return Index.find(Key) != Index.end();
+	}
+
+	int32 Remove(const KeyType& Key)
+	{
+		const auto It = Index.find(Key);
+		if (It == Index.end())
+		{
+			return 0;
+		}
+		RemoveAtIndex(It->second);
+		return 1;
+	}
+
+	void Reserve(int32 Count)
+	{
+		Pairs.Reserve(Count);
+		Index.reserve(Count);
+	}
+
+	void Reset()
+	{
+		Pairs.Reset();
+		Index.clear();
+	}
+
+	void Empty(int32 Slack = 0)
+	{
+		Pairs.Empty(Slack);
+		Index.clear();
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Pairs.GetAllocatedSize() + Index.bucket_count() * sizeof(void*) + Index.size() * (sizeof(KeyType) + sizeof(int32) + sizeof(void*));
+	}
+
+	template <typename AllocatorType>
+	int32 GetKeys(TArray<KeyType, AllocatorType>& OutKeys) const
+	{
+		OutKeys.Reset(Num());
+		for (const ElementType& Pair : Pairs)
+		{
+			OutKeys.Add(Pair.Key);
+		}
+		return OutKeys.Num();
+	}
+
+	class TIterator
+	{
+	public:
+		explicit TIterator(TMap& InMap) : Map(InMap), PairIndex(0), bRemoved(false) {}
+
+		explicit operator bool() const { return PairIndex < Map.Pairs.Num(); }
+		TIterator& operator++()
+		{
+			if (!bRemoved)
+			{
+				PairIndex++;
+			}
+			bRemoved = false;
+			return *this;
+		}
+
+		const KeyType& Key() const { return Map.Pairs[PairIndex].Key; }
+		ValueType& Value() const { return Map.Pairs[PairIndex].Value; }
+
+		// The last pair is swapped into this one's place, so the iterator stays put to visit it next
+		void RemoveCurrent()
+		{
+			Map.RemoveAtIndex(PairIndex);
+			bRemoved = true;
+		}
+
+	private:
+		TMap& Map;
+		int32 PairIndex;
+		bool bRemoved;
+	};
+
+	TIterator CreateIterator() { return TIterator(*this); }
+
+	auto begin() { return Pairs.begin(); }
+	auto end() { return Pairs.end(); }
+	auto begin() const { return Pairs.begin(); }
+	auto end() const { return Pairs.end(); }
+
+private:
+	struct FKeyHash
+	{
+		size_t operator()(const KeyType& Key) const { return GetTypeHash(Key); }
+	};
+
+	void RemoveAtIndex(int32 PairIndex)
+	{
+		Index.erase(Pairs[PairIndex].Key);
+		const int32 LastIndex = Pairs.Num() - 1;
+		if (PairIndex != LastIndex)
+		{
+			Index[Pairs[LastIndex].Key] = PairIndex;
+		}
+		Pairs.RemoveAtSwap(PairIndex);
+	}
+
+	TArray<ElementType> Pairs;
+	std::unordered_map<KeyType, int32, FKeyHash> Index;
+};
+
+// Only as much string as paths and messages need
+class FString
+{
+public:
+	FString() = default;
+	FString(const TCHAR* InString) : String(InString ? InString : "") {}
+	FString(const std::string& InString) : String(InString) {}
+
+	FORCEINLINE const TCHAR* operator*() const { return String.c_str(); }
+	FORCEINLINE int32 Len() const { return (int32)String.size(); }
+	FORCEINLINE bool IsEmpty() const { return String.empty(); }
+
+	friend bool operator==(const FString& A, const FString& B) { return A.String == B.String; }
+	friend bool operator!=(const FString& A, const FString& B) { return A.String != B.String; }
+
+private:
+	std::string String;
+};
+
+template <typename T>
+using TUniquePtr = std::unique_ptr<T>;
+
+template <typename T, typename... ArgTypes>
+FORCEINLINE TUniquePtr<T> MakeUnique(ArgTypes&&... Args)
+{
+	return std::make_unique<T>(std::forward<ArgTypes>(Args)...);
+}
+
+#include "Serialization/Archive.h"
@@ -0,0 +1,33 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IFileManager
+{
+public:
+	static IFileManager& Get()
+	{
+		static IFileManager FileManager;
+		return FileManager;
+	}
+
+	// Both return null if the file can't be opened, and the caller owns whatever they return
+	FArchive* CreateFileWriter(const TCHAR* Filename, uint32 WriteFlags = 0)
+	{
+		FILE* File = std::fopen(Filename, "wb");
+		return File ? new FArchive(File, false) : nullptr;
+	}
+
+	FArchive* CreateFileReader(const TCHAR* Filename, uint32 ReadFlags = 0)
+	{
+		FILE* File = std::fopen(Filename, "rb");
+		return File ? new FArchive(File, true) : nullptr;
+	}
+
+	bool Delete(const TCHAR* Filename)
+	{
+		return std::remove(Filename) == 0;
+	}
+};
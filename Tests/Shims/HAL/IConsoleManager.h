@@ -0,0 +1,15 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// There's no console outside the engine, so console variables are just their backing globals.
+// Tests that want a different setting assign the global directly where it's visible, and restore it afterwards.
+struct FAutoConsoleVariableRef
+{
+	template <typename T>
+	FAutoConsoleVariableRef(const TCHAR* Name, T& RefValue, const TCHAR* Help, uint32 Flags = 0)
+	{
+	}
+};
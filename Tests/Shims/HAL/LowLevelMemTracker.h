@@ -0,0 +1,7 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#define LLM_DECLARE_TAG(...)
+#define LLM_DEFINE_TAG(...)
+#define LLM_SCOPE_BYTAG(...)
@@ -0,0 +1,6 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+// FPlatformTime lives in CoreMinimal.h here, since the engine's shared PCH makes it available everywhere anyway
+#include "CoreMinimal.h"
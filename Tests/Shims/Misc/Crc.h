@@ -0,0 +1,24 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FCrc
+{
+	// Plain bitwise CRC-32, only ever compared against other checksums from the same build
+	static uint32 MemCrc32(const void* Data, int32 Length, uint32 CRC = 0)
+	{
+		const uint8* Bytes = (const uint8*)Data;
+		CRC = ~CRC;
+		for (int32 i = 0; i < Length; i++)
+		{
+			CRC ^= Bytes[i];
+			for (int32 Bit = 0; Bit < 8; Bit++)
+			{
+				CRC = (CRC >> 1) ^ (0xEDB88320u & (0u - (CRC & 1u)));
+			}
+		}
+		return ~CRC;
+	}
+};
@@ -0,0 +1,27 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Scratch arrays come off the regular heap here, the stack allocator only changes where the memory lives
+struct FMemStack
+{
+	static FMemStack& Get()
+	{
+		static thread_local FMemStack MemStack;
+		return MemStack;
+	}
+};
+
+struct FMemMark
+{
+	explicit FMemMark(FMemStack& InMem)
+	{
+	}
+};
+
+template <uint32 Alignment = 0>
+struct TMemStackAllocator
+{
+};
@@ -0,0 +1,6 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#define TRACE_CPUPROFILER_EVENT_SCOPE(...)
+#define TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(...)
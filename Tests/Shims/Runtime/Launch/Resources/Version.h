@@ -0,0 +1,8 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+// The standalone build stands in for the oldest engine that has single precision 2D vectors
+#define ENGINE_MAJOR_VERSION 5
+#define ENGINE_MINOR_VERSION 1
+#define ENGINE_PATCH_VERSION 0
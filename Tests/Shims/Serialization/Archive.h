@@ -0,0 +1,90 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Reads or writes plain values to a file in the same little-endian layout as Core's file archives, so recordings made
+// in the editor load here too
+class FArchive
+{
+public:
+	FArchive(FILE* InFile, bool bInIsLoading)
+		: File(InFile)
+		, bIsLoading(bInIsLoading)
+	{
+		if (bIsLoading)
+		{
+			std::fseek(File, 0, SEEK_END);
+			FileSize = std::ftell(File);
+			std::fseek(File, 0, SEEK_SET);
+		}
+	}
+
+	~FArchive()
+	{
+		Close();
+	}
+
+	FArchive(const FArchive&) = delete;
+	FArchive& operator=(const FArchive&) = delete;
+
+	bool IsLoading() const { return bIsLoading; }
+	bool IsSaving() const { return !bIsLoading; }
+	bool IsError() const { return bIsError; }
+	void SetError() { bIsError = true; }
+
+	int64 Tell() const { return File ? (int64)std::ftell(File) : 0; }
+	int64 TotalSize() const { return bIsLoading ? FileSize : Tell(); }
+	bool AtEnd() const { return Tell() >= TotalSize(); }
+
+	bool Close()
+	{
+		if (File)
+		{
+			bIsError |= std::fclose(File) != 0;
+			File = nullptr;
+		}
+		return !bIsError;
+	}
+
+	void Serialize(void* Data, int64 Num)
+	{
+		if (bIsError || !File)
+		{
+			if (bIsLoading)
+			{
+				std::memset(Data, 0, (size_t)Num);
+			}
+			return;
+		}
+
+		const size_t Transferred = bIsLoading ? std::fread(Data, 1, (size_t)Num, File) : std::fwrite(Data, 1, (size_t)Num, File);
+		if (Transferred != (size_t)Num)
+		{
+			bIsError = true;
+			if (bIsLoading)
+			{
+				std::memset(Data, 0, (size_t)Num);
+			}
+		}
+	}
+
+	template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+	friend FArchive& operator<<(FArchive& Ar, T& Value)
+	{
+		Ar.Serialize(&Value, sizeof(T));
+		return Ar;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FGuid& Guid)
+	{
+		return Ar << Guid.A << Guid.B << Guid.C << Guid.D;
+	}
+
+private:
+	FILE* File;
+	int64 FileSize = 0;
+	bool bIsLoading;
+	bool bIsError = false;
+};
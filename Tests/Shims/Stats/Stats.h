@@ -0,0 +1,12 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+// Stats only report on the work, they don't change it, so standalone builds leave them out
+#define DECLARE_STATS_GROUP(...)
+#define DECLARE_CYCLE_STAT_EXTERN(...)
+#define DECLARE_DWORD_COUNTER_STAT_EXTERN(...)
+#define DEFINE_STAT(...)
+#define SCOPE_CYCLE_COUNTER(...)
+#define INC_DWORD_STAT_BY(...)
+#define SET_DWORD_STAT(...)
@@ -0,0 +1,6 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#define UE_TRACE_CHANNEL_EXTERN(...)
+#define UE_TRACE_CHANNEL_DEFINE(...)
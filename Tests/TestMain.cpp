@@ -0,0 +1,9 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WibblyTestFramework.h"
+
+// Optional first arg runs only the tests with it in their name
+int main(int argc, char** argv)
+{
+	return FWibblyTest::RunAll(argc > 1 ? argv[1] : nullptr) > 0 ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "Verlet.h"
+#include "WibblyTestFramework.h"
+
+namespace VerletTests
+{
+	static const float DeltaTime = 1.f / 60.f;
+
+	// Chains break off their pins after SecondsBeforeBreaking, which would get in the way of testing pinned chains
+	struct FScopedNeverBreak
+	{
+		FScopedNeverBreak() : PreviousSeconds(SecondsBeforeBreaking) { SecondsBeforeBreaking = 1000.f; }
+		~FScopedNeverBreak() { SecondsBeforeBreaking = PreviousSeconds; }
+		float PreviousSeconds;
+	};
+
+	struct FScopedChainSolver
+	{
+		FScopedChainSolver(EVerletStickSolver Solver) : PreviousSolver(ChainSolver) { ChainSolver = (int32)Solver; }
+		~FScopedChainSolver() { ChainSolver = PreviousSolver; }
+		int32 PreviousSolver;
+	};
+
+	// A straight chain of NumPoints points with Spacing between them, optionally pinned at each end, as a cut wire starts off
+	static FVerletChain MakeChain(int32 NumPoints, float Spacing, bool bPinEnds)
+	{
+		FVerletChain Chain(FLinearColor::White, 1.f);
+		for (int32 i = 0; i < NumPoints; i++)
+		{
+			Chain.AddToChain(FVectorType(i * Spacing, 0.f), bPinEnds && (i == 0 || i == NumPoints - 1));
+		}
+		return Chain;
+	}
+
+	// Mean relative stick length error, the same measure the benchmarks report
+	static double CalcLengthError(const FVerletChain& Chain)
+	{
+		double TotalError = 0.0;
+		for (const FVerletStick& Stick : Chain.Sticks)
+		{
+			const float Length = FVectorType::Distance(Chain.Points[Stick.Point0Index].Position, Chain.Points[Stick.Point1Index].Position);
+			TotalError += FMath::Abs(Length - Stick.DesiredLength) / FMath::Max(Stick.DesiredLength, KINDA_SMALL_NUMBER);
+		}
+		return Chain.Sticks.Num() > 0 ? TotalError / Chain.Sticks.Num() : 0.0;
+	}
+
+	static bool IsFinite(const FVerletChain& Chain)
+	{
+		for (const FVerletPoint& Point : Chain.Points)
+		{
+			if (Point.Position.ContainsNaN() || Point.LastPosition.ContainsNaN())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static const EVerletStickSolver AllSolvers[] = { EVerletStickSolver::Relax, EVerletStickSolver::Direct, EVerletStickSolver::XPBD };
+	static const char* SolverNames[] = { "Relax", "Direct", "XPBD" };
+}
+
+using namespace VerletTests;
+
+WIBBLY_TEST(VerletStick_CorrectionScale)
+{
+	Test.TestEqual("Stretched to double", FVerletStick::GetCorrectionScale(FVectorType(6.f, 8.f), 5.f), -0.5f, 1e-5f);
+	Test.TestEqual("Already at length", FVerletStick::GetCorrectionScale(FVectorType(3.f, 4.f), 5.f), 0.f, 1e-5f);
+	Test.TestTrue("Collapsed stick stays finite", FMath::IsFinite(FVerletStick::GetCorrectionScale(FVectorType(0.f, 0.f), 5.f)));
+}
+
+WIBBLY_TEST(VerletChain_PinnedChainHoldsLength)
+{
+	FScopedNeverBreak NeverBreak;
+
+	for (int32 SolverIndex = 0; SolverIndex < 3; SolverIndex++)
+	{
+		FScopedChainSolver Solver(AllSolvers[SolverIndex]);
+
+		// Starts off hanging in a V, with the pins closer together than the chain is long so it can settle into a curve
+		FVerletChain Chain(FLinearColor::White, 1.f);
+		const int32 NumPoints = 32;
+		for (int32 i = 0; i < NumPoints; i++)
+		{
+			Chain.AddToChain(FVectorType(i * 8.f, FMath::Min(i, NumPoints - 1 - i) * 6.f), i == 0 || i == NumPoints - 1);
+		}
+		const FVectorType FirstPin = Chain.Points[0].Position;
+		const FVectorType LastPin = Chain.Points.Last().Position;
+
+		for (int32 Frame = 0; Frame < 120; Frame++)
+		{
+			Chain.Update(DeltaTime);
+		}
+
+		Test.TestTrue(SolverNames[SolverIndex], IsFinite(Chain));
+		Test.TestEqual("First pin stays put", Chain.Points[0].Position, FirstPin, 0.f);
+		Test.TestEqual("Last pin stays put", Chain.Points.Last().Position, LastPin, 0.f);
+		Test.TestTrue("Hangs below its pins", Chain.CalcBounds().Max.Y > 50.f);
+		Test.TestLessEqual("Sticks hold their length", CalcLengthError(Chain), 0.01);
+	}
+}
+
+WIBBLY_TEST(VerletChain_XPBDHoldsLengthLikeRelax)
+{
+	// The chains WibblyWires.Benchmark times: pulled straight between two pins for good, so gravity can only stretch them.
+	// They swing for a while, so the error is averaged over a few seconds once they've had a second to get going.
+	const int32 NumWarmupFrames = 60;
+	const int32 NumMeasuredFrames = 180;
+	for (int32 NumPoints : { 10, 100 })
+	{
+		double LengthErrors[3] = {};
+		for (int32 SolverIndex = 0; SolverIndex < 3; SolverIndex++)
+		{
+			FScopedChainSolver Solver(AllSolvers[SolverIndex]);
+			FVerletChain Chain = MakeChain(NumPoints, 5.f, true);
+			Chain.bHasBroken = true;
+
+			for (int32 Frame = 0; Frame < NumWarmupFrames + NumMeasuredFrames; Frame++)
+			{
+				Chain.Update(DeltaTime);
+				if (Frame >= NumWarmupFrames)
+				{
+					LengthErrors[SolverIndex] += CalcLengthError(Chain) / NumMeasuredFrames;
+				}
+			}
+		}
+
+		Test.TestLessEqual("XPBD holds lengths at least as well as Relax", LengthErrors[2], LengthErrors[0]);
+		Test.TestLessEqual("Direct holds lengths at least as well as Relax", LengthErrors[1], LengthErrors[0]);
+		Test.TestLessEqual("Relax holds lengths to within a couple of percent", LengthErrors[0], 0.02);
+	}
+}
+
+WIBBLY_TEST(VerletChain_CollapsedChainStaysFinite)
+{
+	for (int32 SolverIndex = 0; SolverIndex < 3; SolverIndex++)
+	{
+		FScopedChainSolver Solver(AllSolvers[SolverIndex]);
+
+		// Every point on top of each other, as ShrinkSticks leaves a fully retracted wire
+		FVerletChain Chain = MakeChain(8, 10.f, false);
+		for (FVerletPoint& Point : Chain.Points)
+		{
+			Point.Position = Point.LastPosition = FVectorType(50.f, 50.f);
+		}
+
+		for (int32 Frame = 0; Frame < 10; Frame++)
+		{
+			Chain.Update(DeltaTime);
+		}
+
+		Test.TestTrue(SolverNames[SolverIndex], IsFinite(Chain));
+	}
+}
+
+WIBBLY_TEST(VerletChain_BreaksOffItsPins)
+{
+	FVerletChain Chain = MakeChain(8, 10.f, true);
+	const int32 NumFrames = FMath::CeilToInt((SecondsBeforeBreaking + 0.1f) / DeltaTime);
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		Chain.Update(DeltaTime);
+	}
+
+	Test.TestTrue("Broken", Chain.bHasBroken);
+	Test.TestFalse("First point unpinned", Chain.Points[0].bIsPinned);
+	Test.TestFalse("Last point unpinned", Chain.Points.Last().bIsPinned);
+}
+
+WIBBLY_TEST(VerletChain_UnpinnedChainFalls)
+{
+	FVerletChain Chain = MakeChain(8, 10.f, false);
+	for (int32 Frame = 0; Frame < 30; Frame++)
+	{
+		Chain.Update(DeltaTime);
+	}
+
+	Test.TestTrue("Fell under gravity", Chain.CalcBounds().Min.Y > 10.f);
+	Test.TestLessEqual("Sticks hold their length while falling", CalcLengthError(Chain), 0.01);
+}
+
+WIBBLY_TEST(VerletState_RemovesExpiredChains)
+{
+	FVerletState State;
+	State.AddChain(MakeChain(4, 10.f, false));
+
+	FVerletChain OffScreen = MakeChain(4, 10.f, false);
+	OffScreen.Translate(FVectorType(0.f, 5000.f));
+	State.AddChain(MoveTemp(OffScreen));
+
+	State.RemoveExpiredChains();
+	Test.TestEqual("Only the chain below the screen is removed", State.GetNumChains(), 1);
+	Test.TestEqual("Points counted", State.GetNumPoints(), 4);
+}
+
+WIBBLY_TEST(VerletState_TimeSlicingCarriesTimeOver)
+{
+	FVerletState State;
+	for (int32 i = 0; i < 4; i++)
+	{
+		State.AddChain(MakeChain(4, 10.f, false));
+	}
+
+	// Past the deadline before we start, so only one chain gets a turn and the rest bank their time
+	Test.TestFalse("Not every chain updated", State.UpdateVerletChainsTimeSliced(DeltaTime, FVerletChain::DefaultSubsteps, 0.0));
+
+	int32 NumWaiting = 0;
+	for (const FVerletChain& Chain : State.GetChains())
+	{
+		NumWaiting += Chain.PendingDeltaTime > 0.f ? 1 : 0;
+	}
+	Test.TestEqual("Chains still waiting for their turn", NumWaiting, 3);
+}
+
+WIBBLY_TEST(VerletState_TimeSlicingCatchesUpOnBankedTime)
+{
+	FVerletState State;
+	const int32 NumChains = 4;
+	for (int32 i = 0; i < NumChains; i++)
+	{
+		State.AddChain(MakeChain(4, 10.f, false));
+	}
+
+	// One chain a step, so each banks more than FVerletChain::MaxDeltaTime while it waits for its turn
+	const int32 NumSteps = NumChains * 2;
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		State.UpdateVerletChainsTimeSliced(DeltaTime, FVerletChain::DefaultSubsteps, 0.0);
+	}
+
+	for (const FVerletChain& Chain : State.GetChains())
+	{
+		Test.TestEqual("Simulated and banked time add up to all of it", Chain.Age + Chain.PendingDeltaTime, NumSteps * DeltaTime, 1e-5f);
+	}
+}
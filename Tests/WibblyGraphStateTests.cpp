@@ -0,0 +1,168 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WibblyGraphState.h"
+#include "WibblyTestFramework.h"
+
+namespace WibblyGraphStateTests
+{
+	static const float DeltaTime = 1.f / 60.f;
+	static const FGuid PinA(1, 0, 0, 1);
+	static const FGuid PinB(2, 0, 0, 2);
+	static const FGuid PinC(3, 0, 0, 3);
+
+	static FWireInputBatch MakeBatch(std::initializer_list<FWireInput> Inputs)
+	{
+		FWireInputBatch Batch;
+		Batch.GraphGuid = FGuid(10, 20, 30, 40);
+		for (const FWireInput& Input : Inputs)
+		{
+			Batch.Wires.Add(Input);
+		}
+		return Batch;
+	}
+}
+
+using namespace WibblyGraphStateTests;
+
+WIBBLY_TEST(WireId_KeyedOnPinIds)
+{
+	const FWireId Wire(PinA, PinB);
+	Test.TestTrue("Same pins are the same wire", Wire == FWireId(PinA, PinB));
+	Test.TestTrue("Same hash", GetTypeHash(Wire) == GetTypeHash(FWireId(PinA, PinB)));
+	Test.TestTrue("Reversed pins are a different wire", Wire != FWireId(PinB, PinA));
+	Test.TestTrue("Sharing one pin is a different wire", Wire != FWireId(PinA, PinC));
+	Test.TestFalse("Connected wire", Wire.IsPreviewConnector());
+
+	const FWireId Preview(PinA, FGuid());
+	Test.TestTrue("Missing end is a preview connector", Preview.IsPreviewConnector());
+	Test.TestTrue("Connected end", Preview.GetConnectedPinId() == PinA);
+	Test.TestTrue("Connected start", FWireId(FGuid(), PinB).GetConnectedPinId() == PinB);
+
+	const FWireId Replay = FWireId::MakeReplayId(1, 0, 0x1234);
+	Test.TestTrue("Replays keep their recorded hash", GetTypeHash(Replay) == 0x1234);
+	Test.TestTrue("Replay key 0 is a missing pin", Replay.IsPreviewConnector());
+}
+
+WIBBLY_TEST(GraphState_StepsDrawnWiresUntilTheySettle)
+{
+	FGraphState GraphState;
+	double CurrentTime = 0.0;
+	const FWireInputBatch Batch = MakeBatch({ FWireInput(FWireId(PinA, PinB), FVectorType(0.f, 0.f), FVectorType(300.f, 100.f)) });
+
+	int32 NumSteps = 0;
+	do
+	{
+		CurrentTime += DeltaTime;
+		GraphState.ApplyInputBatch(Batch, CurrentTime);
+		GraphState.Step(EWibblySimulationQuality::Full, CurrentTime, DeltaTime, DBL_MAX);
+		NumSteps++;
+	}
+	while (GraphState.NumMovingWires > 0 && NumSteps < 60 * 20);
+
+	Test.TestEqual("One wire", GraphState.Wires.Num(), 1);
+	Test.TestTrue("Moving at first", NumSteps > 1);
+	Test.TestEqual("Settled", GraphState.NumMovingWires, 0);
+	Test.TestEqual("Timed every step", GraphState.UpdateTimes.Num(), FMath::Min(NumSteps, FWibblyTimingHistory::MaxSamples));
+}
+
+WIBBLY_TEST(GraphState_OnlyStepsDrawnWires)
+{
+	FGraphState GraphState;
+	GraphState.ApplyInputBatch(MakeBatch({ FWireInput(FWireId(PinA, PinB), FVectorType(0.f, 0.f), FVectorType(300.f, 100.f)) }), 0.0);
+	GraphState.Step(EWibblySimulationQuality::Full, DeltaTime, DeltaTime, DBL_MAX);
+
+	const FWireState& WireState = *GraphState.Wires.Find(FWireId(PinA, PinB));
+	const FVectorType Center = WireState.CenterPoint;
+	Test.TestTrue("Was moving", GraphState.IsMoving());
+	Test.TestTrue("Stops counting as moving", GraphState.Step(EWibblySimulationQuality::Full, 2 * DeltaTime, DeltaTime, DBL_MAX));
+	Test.TestEqual("Undrawn wire left where it was", WireState.CenterPoint, Center, 0.f);
+	Test.TestEqual("Nothing moving", GraphState.NumMovingWires, 0);
+
+	Test.TestFalse("Nothing left to do", GraphState.Step(EWibblySimulationQuality::Full, 3 * DeltaTime, DeltaTime, DBL_MAX));
+	Test.TestEqual("Only timed the step that simulated", GraphState.UpdateTimes.Num(), 1);
+}
+
+WIBBLY_TEST(GraphState_SettledWireWithSameInputsChangesNothing)
+{
+	FGraphState GraphState;
+	double CurrentTime = 0.0;
+	const FWireInputBatch Batch = MakeBatch({ FWireInput(FWireId(PinA, PinB), FVectorType(0.f, 0.f), FVectorType(300.f, 100.f)) });
+
+	// Settle it, then one more step so it's also no longer counted as moving
+	for (int32 Step = 0; Step < 60 * 20 && (Step == 0 || GraphState.IsMoving()); Step++)
+	{
+		CurrentTime += DeltaTime;
+		GraphState.ApplyInputBatch(Batch, CurrentTime);
+		GraphState.Step(EWibblySimulationQuality::Full, CurrentTime, DeltaTime, DBL_MAX);
+	}
+	CurrentTime += DeltaTime;
+	GraphState.ApplyInputBatch(Batch, CurrentTime);
+	GraphState.Step(EWibblySimulationQuality::Full, CurrentTime, DeltaTime, DBL_MAX);
+
+	const FVectorType Center = GraphState.Wires.Find(FWireId(PinA, PinB))->CenterPoint;
+	CurrentTime += DeltaTime;
+	GraphState.ApplyInputBatch(Batch, CurrentTime);
+	Test.TestFalse("Nothing changed", GraphState.Step(EWibblySimulationQuality::Full, CurrentTime, DeltaTime, DBL_MAX));
+	Test.TestEqual("Left where it was", GraphState.Wires.Find(FWireId(PinA, PinB))->CenterPoint, Center, 0.f);
+
+	// Moving an end does change it, even after going a long while without being submitted
+	CurrentTime += 5.0;
+	GraphState.ApplyInputBatch(MakeBatch({ FWireInput(FWireId(PinA, PinB), FVectorType(0.f, 0.f), FVectorType(300.f, 200.f)) }), CurrentTime);
+	Test.TestTrue("Moved end changes it", GraphState.Step(EWibblySimulationQuality::Full, CurrentTime, DeltaTime, DBL_MAX));
+	Test.TestTrue("Swings rather than snapping to rest", GraphState.IsMoving());
+}
+
+WIBBLY_TEST(GraphState_HiddenGraphCatchesUp)
+{
+	FGraphState GraphState;
+	const FWireId WireId(PinA, PinB);
+	GraphState.ApplyInputBatch(MakeBatch({ FWireInput(WireId, FVectorType(0.f, 0.f), FVectorType(300.f, 100.f)) }), 0.0);
+	GraphState.Step(EWibblySimulationQuality::StaticWires, 0.0, DeltaTime, DBL_MAX);
+
+	// Back after a long time away with its end somewhere else, which it should already have settled on
+	FWireInputBatch Batch = MakeBatch({ FWireInput(WireId, FVectorType(0.f, 0.f), FVectorType(300.f, 200.f)) });
+	Batch.bWasHidden = true;
+	GraphState.ApplyInputBatch(Batch, 10.0);
+	GraphState.Step(EWibblySimulationQuality::Full, 10.0, DeltaTime, DBL_MAX);
+
+	const FWireParams Params = FWireParams::FromHash(GetTypeHash(WireId), WireId.IsPreviewConnector());
+	Test.TestTrue("Caught up to rest", GraphState.Wires.Find(WireId)->IsAtRest(Params));
+}
+
+WIBBLY_TEST(GraphState_StaticQualitySnapsToRest)
+{
+	FGraphState GraphState;
+	const FWireId WireId(PinA, PinB);
+	GraphState.ApplyInputBatch(MakeBatch({ FWireInput(WireId, FVectorType(0.f, 0.f), FVectorType(300.f, 100.f)) }), 0.0);
+	GraphState.Step(EWibblySimulationQuality::StaticWires, DeltaTime, DeltaTime, DBL_MAX);
+
+	const FWireParams Params = FWireParams::FromHash(GetTypeHash(WireId), WireId.IsPreviewConnector());
+	Test.TestEqual("Nothing moving", GraphState.NumMovingWires, 0);
+	Test.TestTrue("At rest straight away", GraphState.Wires.Find(WireId)->IsAtRest(Params));
+}
+
+WIBBLY_TEST(GraphState_ConnectedWireInheritsPreviewConnector)
+{
+	FGraphState GraphState;
+	const FVectorType Start(0.f, 0.f);
+	const FVectorType End(300.f, 100.f);
+
+	// Drag a preview connector out of PinA for a while, so it's somewhere its own initial state wouldn't be
+	const FWireId PreviewId(PinA, FGuid());
+	double CurrentTime = 0.0;
+	for (int32 Step = 0; Step < 10; Step++)
+	{
+		CurrentTime += DeltaTime;
+		GraphState.ApplyInputBatch(MakeBatch({ FWireInput(PreviewId, Start, End + FVectorType(0.f, Step * 5.f)) }), CurrentTime);
+		GraphState.Step(EWibblySimulationQuality::Full, CurrentTime, DeltaTime, DBL_MAX);
+	}
+	const FWireState PreviewState = *GraphState.Wires.Find(PreviewId);
+
+	// Then drop it on PinB, and on an unrelated pair of pins in the same spot
+	CurrentTime += DeltaTime;
+	const FVectorType DropPoint = PreviewState.TargetEndPoint;
+	GraphState.ApplyInputBatch(MakeBatch({ FWireInput(FWireId(PinA, PinB), Start, DropPoint), FWireInput(FWireId(PinC, PinB), Start, DropPoint) }), CurrentTime);
+
+	Test.TestEqual("Connected wire carries on from the preview", GraphState.Wires.Find(FWireId(PinA, PinB))->CenterVelocity, PreviewState.CenterVelocity, 0.f);
+	Test.TestTrue("Unrelated wire starts fresh", GraphState.Wires.Find(FWireId(PinC, PinB))->CenterVelocity == FVectorType::ZeroVector);
+}
@@ -0,0 +1,47 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+//
+// Replays a recording from WibblyWires.Record without an editor, reporting the same timings and checksum as the
+// WibblyWires.Replay console command:
+//
+//   WibblyReplay <recording.wibbly> [runs]
+
+#include "WireRecording.h"
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s <recording.wibbly> [runs]\n", argv[0]);
+		return 2;
+	}
+
+	const FString Path(argv[1]);
+	const int32 NumRuns = argc > 2 ? std::atoi(argv[2]) : 1;
+
+	FWireReplay Replay;
+	if (!Replay.Load(Path))
+	{
+		std::fprintf(stderr, "WibblyWires: Couldn't load recording %s\n", *Path);
+		return 1;
+	}
+
+	for (int32 Run = 0; Run < FMath::Max(NumRuns, 1); Run++)
+	{
+		TArray<double> StepSeconds;
+		const uint32 Checksum = Replay.Run(StepSeconds);
+
+		double TotalSeconds = 0.0;
+		for (double Seconds : StepSeconds)
+		{
+			TotalSeconds += Seconds;
+		}
+		StepSeconds.Sort();
+
+		const double P95Seconds = StepSeconds.Num() > 0 ? StepSeconds[FMath::Clamp(FMath::CeilToInt(0.95f * StepSeconds.Num()) - 1, 0, StepSeconds.Num() - 1)] : 0.0;
+		const double MaxSeconds = StepSeconds.Num() > 0 ? StepSeconds.Last() : 0.0;
+		std::printf("WibblyWires: Replayed %d steps in %.3f ms (avg %.3f ms, p95 %.3f ms, max %.3f ms), checksum %08x\n",
+			Replay.GetNumSteps(), TotalSeconds * 1000.0, StepSeconds.Num() > 0 ? TotalSeconds * 1000.0 / StepSeconds.Num() : 0.0, P95Seconds * 1000.0, MaxSeconds * 1000.0, Checksum);
+	}
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Just enough of a test runner for the standalone build. Tests read like automation tests (TestTrue, TestEqual, ...),
+// each one records its own failures and carries on, and the executable fails if any of them did.
+class FWibblyTest
+{
+public:
+	typedef void (*FTestFunction)(FWibblyTest& Test);
+
+	FWibblyTest(const char* InName, FTestFunction InFunction)
+		: Name(InName)
+		, Function(InFunction)
+	{
+		GetAllTests().push_back(this);
+	}
+
+	bool TestTrue(const char* What, bool bValue)
+	{
+		if (!bValue)
+		{
+			AddError(What, "expected true");
+		}
+		return bValue;
+	}
+
+	bool TestFalse(const char* What, bool bValue)
+	{
+		if (bValue)
+		{
+			AddError(What, "expected false");
+		}
+		return !bValue;
+	}
+
+	bool TestEqual(const char* What, int64 Actual, int64 Expected)
+	{
+		if (Actual != Expected)
+		{
+			AddError(What, "expected %lld, got %lld", (long long)Expected, (long long)Actual);
+			return false;
+		}
+		return true;
+	}
+
+	bool TestEqual(const char* What, float Actual, float Expected, float Tolerance)
+	{
+		if (!(FMath::Abs(Actual - Expected) <= Tolerance))
+		{
+			AddError(What, "expected %g, got %g (tolerance %g)", Expected, Actual, Tolerance);
+			return false;
+		}
+		return true;
+	}
+
+	bool TestEqual(const char* What, const FVector2f& Actual, const FVector2f& Expected, float Tolerance)
+	{
+		if (!Actual.Equals(Expected, Tolerance))
+		{
+			AddError(What, "expected (%g, %g), got (%g, %g) (tolerance %g)", Expected.X, Expected.Y, Actual.X, Actual.Y, Tolerance);
+			return false;
+		}
+		return true;
+	}
+
+	bool TestLessEqual(const char* What, double Actual, double Limit)
+	{
+		if (!(Actual <= Limit))
+		{
+			AddError(What, "expected at most %g, got %g", Limit, Actual);
+			return false;
+		}
+		return true;
+	}
+
+	// Runs every test whose name contains Filter (or all of them), returning how many failed
+	static int32 RunAll(const char* Filter)
+	{
+		int32 NumRun = 0;
+		int32 NumFailed = 0;
+		for (FWibblyTest* Test : GetAllTests())
+		{
+			if (Filter && !std::strstr(Test->Name, Filter))
+			{
+				continue;
+			}
+
+			Test->Function(*Test);
+			NumRun++;
+			NumFailed += Test->NumErrors > 0 ? 1 : 0;
+			std::printf("%s %s\n", Test->NumErrors > 0 ? "FAIL" : "ok  ", Test->Name);
+		}
+
+		std::printf("%d tests, %d failed\n", NumRun, NumFailed);
+		return NumFailed;
+	}
+
+private:
+	template <typename... ArgTypes>
+	void AddError(const char* What, const char* Format, ArgTypes... Args)
+	{
+		NumErrors++;
+		std::printf("  %s: %s: ", Name, What);
+		std::printf(Format, Args...);
+		std::printf("\n");
+	}
+
+	static std::vector<FWibblyTest*>& GetAllTests()
+	{
+		static std::vector<FWibblyTest*> AllTests;
+		return AllTests;
+	}
+
+	const char* Name;
+	FTestFunction Function;
+	int32 NumErrors = 0;
+};
+
+// Defines a test function and registers it to run, e.g. WIBBLY_TEST(WireState_SettlesAtRest) { Test.TestTrue(...); }
+#define WIBBLY_TEST(TestName) \
+	static void TestName(FWibblyTest& Test); \
+	static FWibblyTest TestName##Registration(#TestName, &TestName); \
+	static void TestName(FWibblyTest& Test)
@@ -0,0 +1,134 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WibblyTestFramework.h"
+#include "WireCurve.h"
+
+namespace WireCurveTests
+{
+	static const FVectorType P0(0.f, 0.f);
+	static const FVectorType P0Tangent(300.f, 0.f);
+	static const FVectorType P1(200.f, 100.f);
+	static const FVectorType P1Tangent(300.f, 0.f);
+
+	// The hermite basis written out longhand, as FMath::CubicInterp has it
+	static FVectorType CubicInterp(float Alpha)
+	{
+		const float A2 = Alpha * Alpha;
+		const float A3 = A2 * Alpha;
+		return (((2 * A3) - (3 * A2) + 1) * P0) + ((A3 - (2 * A2) + Alpha) * P0Tangent) + ((A3 - A2) * P1Tangent) + (((-2 * A3) + (3 * A2)) * P1);
+	}
+}
+
+using namespace WireCurveTests;
+
+WIBBLY_TEST(WireCurve_EvalMatchesHermite)
+{
+	const FWireCurve Curve(P0, P0Tangent, P1, P1Tangent);
+	Test.TestEqual("Starts at P0", Curve.Eval(0.f), P0, 1e-4f);
+	Test.TestEqual("Ends at P1", Curve.Eval(1.f), P1, 1e-3f);
+
+	for (float Alpha = 0.f; Alpha <= 1.f; Alpha += 0.125f)
+	{
+		Test.TestEqual("Matches the hermite basis", Curve.Eval(Alpha), CubicInterp(Alpha), 1e-3f);
+	}
+}
+
+WIBBLY_TEST(WireCurve_DerivativeMatchesFiniteDifference)
+{
+	const FWireCurve Curve(P0, P0Tangent, P1, P1Tangent);
+	const float Step = 1e-3f;
+
+	for (float Alpha = 0.1f; Alpha < 0.95f; Alpha += 0.2f)
+	{
+		FVectorType Position;
+		FVectorType Derivative;
+		Curve.EvalWithDerivative(Alpha, Position, Derivative);
+
+		const FVectorType Difference = (Curve.Eval(Alpha + Step) - Curve.Eval(Alpha - Step)) / (2.f * Step);
+		Test.TestEqual("Position matches Eval", Position, Curve.Eval(Alpha), 1e-4f);
+		Test.TestEqual("Derivative matches central difference", Derivative, Difference, 0.5f);
+	}
+
+	FVectorType Position;
+	FVectorType Derivative;
+	Curve.EvalWithDerivative(0.f, Position, Derivative);
+	Test.TestEqual("Starts along P0's tangent", Derivative, P0Tangent, 1e-3f);
+}
+
+WIBBLY_TEST(WireCurve_FindClosestPoint)
+{
+	// Tangents that match the chord make the curve a straight line
+	const FWireCurve Line(FVectorType(0.f, 0.f), FVectorType(100.f, 0.f), FVectorType(100.f, 0.f), FVectorType(100.f, 0.f));
+
+	FVectorType ClosestPoint;
+	Test.TestEqual("Distance to the side", Line.FindClosestPoint(FVectorType(30.f, 10.f), 16, ClosestPoint), 100.f, 1e-2f);
+	Test.TestEqual("Closest point is straight across", ClosestPoint, FVectorType(30.f, 0.f), 1e-3f);
+
+	Test.TestEqual("Distance past the end", Line.FindClosestPoint(FVectorType(130.f, 0.f), 16, ClosestPoint), 900.f, 1e-1f);
+	Test.TestEqual("Clamped to the end", ClosestPoint, FVectorType(100.f, 0.f), 1e-3f);
+}
+
+WIBBLY_TEST(WireCurve_ClosestPointOnSegment)
+{
+	const FVectorType A(0.f, 0.f);
+	const FVectorType B(10.f, 0.f);
+	Test.TestEqual("Projects onto the segment", FWireCurve::ClosestPointOnSegment(FVectorType(4.f, 3.f), A, B), FVectorType(4.f, 0.f), 1e-5f);
+	Test.TestEqual("Clamps before the start", FWireCurve::ClosestPointOnSegment(FVectorType(-5.f, 3.f), A, B), A, 1e-5f);
+	Test.TestEqual("Clamps after the end", FWireCurve::ClosestPointOnSegment(FVectorType(15.f, -3.f), A, B), B, 1e-5f);
+	Test.TestEqual("Degenerate segment", FWireCurve::ClosestPointOnSegment(FVectorType(1.f, 1.f), A, A), A, 0.f);
+}
+
+WIBBLY_TEST(WireCurve_EvalManyMatchesEval)
+{
+	const FWireCurve Curve(P0, P0Tangent, P1, P1Tangent);
+	const TArray<float> Alphas = { 0.f, 0.2f, 0.5f, 0.7f, 1.f };
+
+	TArray<FVectorType> Positions;
+	Curve.EvalMany(Alphas, Positions);
+	if (Test.TestEqual("One position per alpha", Positions.Num(), Alphas.Num()))
+	{
+		for (int32 i = 0; i < Alphas.Num(); i++)
+		{
+			Test.TestEqual("Same as Eval", Positions[i], Curve.Eval(Alphas[i]), 0.f);
+		}
+	}
+}
+
+WIBBLY_TEST(WireCurve_EvalSortedArcLengths)
+{
+	// Evenly spaced arc lengths map straight back to alphas
+	{
+		const TArray<float> ArcLengths = { 0.f, 10.f, 20.f, 30.f, 40.f };
+		const TArray<float> Inputs = { 0.f, 5.f, 20.f, 40.f };
+		TArray<float> Alphas;
+		Alphas.SetNumZeroed(Inputs.Num());
+		EvalSortedArcLengths(ArcLengths, Inputs, Alphas);
+
+		Test.TestEqual("Start", Alphas[0], 0.f, 1e-6f);
+		Test.TestEqual("Within the first segment", Alphas[1], 0.125f, 1e-6f);
+		Test.TestEqual("Middle", Alphas[2], 0.5f, 1e-6f);
+		Test.TestEqual("End", Alphas[3], 1.f, 1e-6f);
+	}
+
+	// Uneven segments interpolate within whichever segment each distance lands in
+	{
+		const TArray<float> ArcLengths = { 0.f, 30.f, 40.f };
+		const TArray<float> Inputs = { 15.f, 35.f, 100.f };
+		TArray<float> Alphas;
+		Alphas.SetNumZeroed(Inputs.Num());
+		EvalSortedArcLengths(ArcLengths, Inputs, Alphas);
+
+		Test.TestEqual("Halfway along the long segment", Alphas[0], 0.25f, 1e-6f);
+		Test.TestEqual("Halfway along the short segment", Alphas[1], 0.75f, 1e-6f);
+		Test.TestEqual("Past the end clamps", Alphas[2], 1.f, 1e-6f);
+	}
+
+	// Nothing to walk
+	{
+		const TArray<float> ArcLengths = { 0.f };
+		const TArray<float> Inputs = { 5.f };
+		TArray<float> Alphas = { -1.f };
+		EvalSortedArcLengths(ArcLengths, Inputs, Alphas);
+		Test.TestEqual("No segments gives the start", Alphas[0], 0.f, 0.f);
+	}
+}
@@ -0,0 +1,101 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "HAL/FileManager.h"
+#include "WibblyTestFramework.h"
+#include "WireRecording.h"
+
+namespace WireRecordingTests
+{
+	static const float DeltaTime = 1.f / 60.f;
+	static const FGuid GraphA(10, 20, 30, 40);
+	static const FGuid GraphB(50, 60, 70, 80);
+	static const TCHAR* RecordingPath = TEXT("WireRecordingTests.wibbly");
+
+	// Steps a couple of graphs the way the live simulation does, recording as it goes, and returns where they ended up
+	static uint32 RecordSteps(int32 NumSteps)
+	{
+		TUniquePtr<FWireRecorder> Recorder = FWireRecorder::Create(RecordingPath);
+		if (!Recorder)
+		{
+			return 0;
+		}
+
+		TMap<FGuid, FGraphState> GraphStates;
+		double CurrentTime = 0.0;
+		for (int32 Step = 0; Step < NumSteps; Step++)
+		{
+			CurrentTime += DeltaTime;
+
+			// Graph B is dropped halfway through and starts over, as if it had gone undrawn long enough to be evicted
+			if (Step == NumSteps / 2)
+			{
+				GraphStates.Remove(GraphB);
+				Recorder->EvictGraph(GraphB);
+			}
+
+			// Graph A has a wire being dragged around plus one that's still, graph B only gets drawn every other step
+			TArray<FWireInputBatch> Batches;
+			FWireInputBatch& BatchA = Batches.AddDefaulted_GetRef();
+			BatchA.GraphGuid = GraphA;
+			BatchA.Wires.Emplace(FWireId(FGuid(1, 0, 0, 1), FGuid()), FVectorType(0.f, 0.f), FVectorType(200.f + Step * 4.f, 50.f));
+			BatchA.Wires.Emplace(FWireId(FGuid(2, 0, 0, 2), FGuid(3, 0, 0, 3)), FVectorType(0.f, 100.f), FVectorType(300.f, 200.f));
+			if (Step % 2 == 0)
+			{
+				FWireInputBatch& BatchB = Batches.AddDefaulted_GetRef();
+				BatchB.GraphGuid = GraphB;
+				BatchB.Wires.Emplace(FWireId(FGuid(4, 0, 0, 4), FGuid(5, 0, 0, 5)), FVectorType(-50.f, 0.f), FVectorType(50.f, 300.f));
+			}
+
+			for (FWireInputBatch& Batch : Batches)
+			{
+				GraphStates.FindOrAdd(Batch.GraphGuid).ApplyInputBatch(Batch, CurrentTime);
+				Recorder->AddBatch(MoveTemp(Batch));
+			}
+
+			for (auto& GraphPair : GraphStates)
+			{
+				GraphPair.Value.Step(EWibblySimulationQuality::Full, CurrentTime, DeltaTime, DBL_MAX);
+			}
+			Recorder->FinishStep(CurrentTime, DeltaTime, EWibblySimulationQuality::Full, false);
+		}
+
+		return FWireReplay::CalcChecksum(GraphStates);
+	}
+}
+
+using namespace WireRecordingTests;
+
+WIBBLY_TEST(WireReplay_MatchesTheRecordedRun)
+{
+	const int32 NumSteps = 90;
+	const uint32 RecordedChecksum = RecordSteps(NumSteps);
+
+	FWireReplay Replay;
+	if (Test.TestTrue("Loads", Replay.Load(RecordingPath)))
+	{
+		Test.TestEqual("Every step recorded", Replay.GetNumSteps(), NumSteps);
+
+		TArray<double> StepSeconds;
+		Test.TestTrue("Ends up where the recorded run did", Replay.Run(StepSeconds) == RecordedChecksum);
+		Test.TestEqual("Timed every step", StepSeconds.Num(), NumSteps);
+		Test.TestTrue("Same again on a second run", Replay.Run(StepSeconds) == RecordedChecksum);
+	}
+
+	IFileManager::Get().Delete(RecordingPath);
+}
+
+WIBBLY_TEST(WireReplay_RejectsOtherFiles)
+{
+	FWireReplay Replay;
+	Test.TestFalse("Missing file", Replay.Load(TEXT("DoesNotExist.wibbly")));
+
+	if (FArchive* Writer = IFileManager::Get().CreateFileWriter(RecordingPath))
+	{
+		uint32 NotMagic = 0x12345678;
+		*Writer << NotMagic;
+		delete Writer;
+	}
+	Test.TestFalse("Wrong magic", Replay.Load(RecordingPath));
+
+	IFileManager::Get().Delete(RecordingPath);
+}
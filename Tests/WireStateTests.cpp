@@ -0,0 +1,124 @@
+// Copyright 2022 Geordie Hall. All rights reserved.
+
+#include "WibblyTestFramework.h"
+#include "WireState.h"
+
+namespace WireStateTests
+{
+	static const FVectorType Start(0.f, 0.f);
+	static const FVectorType End(300.f, 80.f);
+	static const float DeltaTime = 1.f / 60.f;
+
+	// Simulates at DeltaTime until the wire says it's stopped moving, returning how many seconds that took (or -1 if it didn't)
+	static float SimulateUntilResting(FWireState& WireState, const FWireParams& Params, double& CurrentTime, float MaxSeconds)
+	{
+		for (float Elapsed = 0.f; Elapsed < MaxSeconds; Elapsed += DeltaTime)
+		{
+			CurrentTime += DeltaTime;
+			if (!WireState.Simulate(CurrentTime, DeltaTime, Params))
+			{
+				return Elapsed;
+			}
+		}
+		return -1.f;
+	}
+}
+
+using namespace WireStateTests;
+
+WIBBLY_TEST(WireParams_FromHashStaysInRange)
+{
+	for (uint32 i = 0; i < 10000; i++)
+	{
+		const uint32 Hash = i * 2654435761u;
+		const FWireParams Params = FWireParams::FromHash(Hash, false);
+		if (!Test.TestTrue("Stiffness in range", Params.SpringStiffness >= 30.f && Params.SpringStiffness <= 150.3f)
+			|| !Test.TestTrue("Dampening in range", Params.SpringDampeningRatio >= 0.3f && Params.SpringDampeningRatio <= 0.9f)
+			|| !Test.TestTrue("Slack in range", Params.DesiredSlackMultiplier >= 1.3f && Params.DesiredSlackMultiplier <= 1.6f))
+		{
+			return;
+		}
+	}
+}
+
+WIBBLY_TEST(WireParams_FromHashIsDeterministic)
+{
+	const FWireParams First = FWireParams::FromHash(0xDEADBEEF, false);
+	const FWireParams Second = FWireParams::FromHash(0xDEADBEEF, false);
+	Test.TestEqual("Stiffness", First.SpringStiffness, Second.SpringStiffness, 0.f);
+	Test.TestEqual("Dampening", First.SpringDampeningRatio, Second.SpringDampeningRatio, 0.f);
+	Test.TestEqual("Slack", First.DesiredSlackMultiplier, Second.DesiredSlackMultiplier, 0.f);
+
+	const FWireParams Preview = FWireParams::FromHash(0xDEADBEEF, true);
+	Test.TestTrue("Preview connectors are a little stiffer", Preview.SpringStiffness > First.SpringStiffness);
+}
+
+WIBBLY_TEST(WireState_SettlesAfterTargetsMove)
+{
+	const FWireParams Params = FWireParams::FromHash(1234, false);
+	FWireState WireState(Start, End, Params);
+
+	double CurrentTime = 0.0;
+	WireState.LastSimulatedTime = CurrentTime;
+	Test.TestTrue("Settles from its initial bounce", SimulateUntilResting(WireState, Params, CurrentTime, 20.f) >= 0.f);
+	Test.TestTrue("At rest", WireState.IsAtRest(Params));
+
+	const FVectorType RestingCenter = WireState.CenterPoint;
+	WireState.SetTargets(Start, End + FVectorType(0.f, 200.f));
+	CurrentTime += DeltaTime;
+	Test.TestTrue("Moving once its targets move", WireState.Simulate(CurrentTime, DeltaTime, Params));
+	Test.TestTrue("Settles on the new targets", SimulateUntilResting(WireState, Params, CurrentTime, 20.f) >= 0.f);
+	Test.TestTrue("Center moved down with the end", WireState.CenterPoint.Y > RestingCenter.Y);
+}
+
+WIBBLY_TEST(WireState_RestingWireIsLeftAlone)
+{
+	const FWireParams Params = FWireParams::FromHash(99, false);
+	FWireState WireState(Start, End, Params);
+	WireState.SnapToRest(0.0, Params);
+	Test.TestTrue("At rest after snapping", WireState.IsAtRest(Params));
+
+	const FVectorType Center = WireState.CenterPoint;
+	WireState.SetTargets(Start, End);
+	Test.TestFalse("Not moving with the same targets", WireState.Simulate(DeltaTime, DeltaTime, Params));
+	Test.TestEqual("Center untouched", WireState.CenterPoint, Center, 0.f);
+}
+
+WIBBLY_TEST(WireState_CatchUpCoversTheWholeFrame)
+{
+	const FWireParams Params = FWireParams::FromHash(42, false);
+	FWireState Simulated(Start, End, Params);
+	Simulated.LastSimulatedTime = 0.0;
+	Simulated.SetTargets(Start, End + FVectorType(0.f, 100.f));
+	FWireState CaughtUp = Simulated;
+
+	// Long enough since it was last simulated to catch up, which should already account for this frame's DeltaTime
+	const float ElapsedTime = 0.5f;
+	Simulated.Simulate(ElapsedTime, DeltaTime, Params);
+	CaughtUp.CatchUp(ElapsedTime, Params);
+
+	Test.TestEqual("Same center as catching up alone", Simulated.CenterPoint, CaughtUp.CenterPoint, 1e-4f);
+	Test.TestEqual("Same velocity as catching up alone", Simulated.CenterVelocity, CaughtUp.CenterVelocity, 1e-4f);
+	Test.TestFalse("Targets consumed", Simulated.bTargetsMoved);
+}
+
+WIBBLY_TEST(WireState_LongGapSnapsToRest)
+{
+	const FWireParams Params = FWireParams::FromHash(7, false);
+	FWireState WireState(Start, End, Params);
+	WireState.LastSimulatedTime = 0.0;
+	WireState.SetTargets(Start, End + FVectorType(50.f, 50.f));
+
+	Test.TestFalse("Nothing left to do after a long gap", WireState.Simulate(10.0, DeltaTime, Params));
+	Test.TestTrue("At rest", WireState.IsAtRest(Params));
+}
+
+WIBBLY_TEST(WireState_DesiredCenterHangsBelowEndpoints)
+{
+	const FVectorType Center = FWireState::CalculateDesiredCenterPoint(Start, End);
+	Test.TestEqual("Level wire hangs from its middle", FWireState::CalculateDesiredCenterPoint(FVectorType(0.f, 0.f), FVectorType(100.f, 0.f)), FVectorType(50.f, 0.f), 1e-4f);
+	Test.TestTrue("Between the endpoints", Center.X >= Start.X && Center.X <= End.X);
+
+	const FVectorType Slack = FWireState::CalculateDesiredCenterPointWithRopeLengthDelta(Start, End, 40.f);
+	Test.TestTrue("Extra rope hangs lower", Slack.Y > Center.Y);
+}